@@ -1,13 +1,21 @@
+#include "ArchiveWriters.h"
+#include "AssetHeader.h"
 #include "Hashers.h"
 #include "MemMappedArchive.h"
 #include "MemMapper.h"
+#include "ThreadPool.h"
 #include "ZSTDComp.h"
 
 #include <CLI11.hpp>
 
 #include <algorithm>
+#include <exception>
 #include <filesystem>
+#include <fstream>
 #include <map>
+#include <mutex>
+#include <set>
+#include <vector>
 
 // Workaround for https://gcc.gnu.org/bugzilla/show_bug.cgi?id=95833
 // Also defined in ZSTDComp.cpp
@@ -35,14 +43,26 @@ class AssetMapCLI {
 	int strategy				 = 0;
 	float loadFactor		 = 0.8f;
 	float dictSizeRatio	 = 0.01f;
+	unsigned threads		 = 1;
 	Mode mode						 = Mode::COMPRESS;
 	bool overwrite			 = false;
 	bool skip						 = false;
 	bool rebuildDict		 = false;
+	bool manifest				 = false;
+	bool deduplicate		 = false;
+	bool store					 = false;
+	bool perfectHash		 = false;
+	bool bucketTags			 = false;
+	bool lookupIndex		 = false;
+	bool nameTable			 = false;
+	lam_size_t chunkSize = 0;
 	std::string oneFile;
+	std::string header;
+	std::string headerNamespace = "Assets";
 	fs::directory_entry dir;
 	fs::directory_entry file;
 	fs::directory_entry dict;
+	fs::directory_entry previous;
 	int exitCode = 0;
 
 	void SetupDictionary(ZSTD& zstd) {
@@ -56,12 +76,82 @@ class AssetMapCLI {
 	}
 
 	void Compress(ICompress& comp, const IHasher& hash) {
-		if (file.exists()) {
-			fs::remove(file.path());
-			file.refresh();
+		BuildOptions options;
+		options.threads			= threads;
+		options.manifest		= manifest;
+		options.deduplicate = deduplicate;
+		options.store				= store;
+		options.perfectHash = perfectHash;
+		options.fingerprint = !header.empty();
+		options.bucketTags	= bucketTags;
+		options.lookupIndex = lookupIndex;
+		options.nameTable		= nameTable;
+		options.chunkSize		= chunkSize;
+		if (previous == fs::directory_entry{}) {
+			StreamWriter out{file.path()};
+			MemMappedArchive::Build(dir, hash, out, comp, options);
+		} else {
+			// The previous archive may well be the one being replaced so write
+			// alongside it and only swap it in once the new archive is complete.
+			auto target = file.path();
+			target += ".tmp";
+			{
+				ZSTD zstd{ZSTD::decompress};
+				MemMapper in{previous};
+				MemMappedArchive old{in, zstd, hash};
+				options.previous = &old;
+				StreamWriter out{target};
+				MemMappedArchive::Build(dir, hash, out, comp, options);
+			}
+			fs::rename(target, file.path());
+		}
+		if (!header.empty())
+			WriteHeader(hash);
+	}
+
+	void WriteHeader(const IHasher& hash) const {
+		ZSTD zstd{ZSTD::decompress};
+		MemMapper in{fs::directory_entry{file.path()}};
+		MemMappedArchive archive{in, zstd, hash};
+		std::ofstream out{header, std::ios::trunc};
+		WriteAssetHeader(archive, out, headerNamespace);
+		if (!out)
+			throw std::runtime_error{"Failed to write " + header};
+	}
+
+	//! Files up to this size are decompressed whole and written at once.
+	static constexpr size_t smallFile = 1 << 20;
+
+	//! The number of files handed to a worker at once.
+	static constexpr size_t extractBatch = 64;
+
+	//! Writes the file out. Small files are decompressed into \c buf and
+	//! written at once; larger ones are streamed so that only a block of them
+	//! is held in memory.
+	static void Extract(MemMappedBucketEntry& item,
+											const fs::path& path,
+											std::vector<uint8_t>& buf) {
+		std::ofstream out{path, std::ios::binary | std::ios::trunc};
+		auto write = [&out](const uint8_t* data, size_t len) {
+			out.write(reinterpret_cast<const char*>(data), len);
+			return static_cast<bool>(out);
+		};
+		if (auto [data, len] = item.Stored(); data != nullptr) {
+			write(data, len);
+		} else if (item.DecompressedSize() <= smallFile) {
+			auto [data, len] = item.Retrieve([&buf](size_t len) {
+				buf.resize(len);
+				return buf.data();
+			});
+			if (len != buf.size())
+				throw std::runtime_error{"Failed to decompress " +
+																 std::string{item.Name()}};
+			write(data, len);
+		} else {
+			item.Stream(write);
 		}
-		MemMapper out{file};
-		MemMappedArchive{dir, hash, out, comp};
+		if (!out)
+			throw std::runtime_error{"Failed to write " + path.generic_u8string()};
 	}
 
 	void Decompress(IDecompress& zstd, const IHasher& hash) const {
@@ -77,31 +167,79 @@ class AssetMapCLI {
 				throw std::runtime_error{oneFile +
 																 " already exists. specify -f or delete it."};
 			fs::remove(path);
-			MemMapper out{path};
-			out.Resize(item.DecompressedSize());
-			out.Resize(item.Retrieve(out.Get(), out.Size()));
+			std::vector<uint8_t> buf;
+			Extract(item, path, buf);
 			return;
 		}
+		struct Extraction {
+			MemMappedBucketEntry item;
+			fs::path path;
+			bool replace;
+		};
+		// Everything is checked before anything is written, and every directory
+		// is created once, rather than once per file.
+		std::vector<Extraction> items;
+		std::set<fs::path> dirs;
 		for (auto&& bucket : archive) {
 			for (auto&& item : bucket) {
-				auto loc = dir.path() / item.Name();
-				fs::create_directories(loc.parent_path());
-				auto ent = fs::directory_entry{loc};
-				if (ent.exists()) {
+				auto loc		 = dir.path() / item.Name();
+				auto replace = fs::exists(loc);
+				if (replace) {
 					if (skip)
 						continue;
 					if (!overwrite)
 						throw std::runtime_error{
-								ent.path().generic_u8string() +
+								loc.generic_u8string() +
 								" already exists and neither overwrite (-f) nor  skip "
 								"existing (-e) specified. Aborted"};
-					fs::remove(ent);
 				}
-				MemMapper out{ent};
-				out.Resize(item.DecompressedSize());
-				out.Resize(item.Retrieve(out.Get(), out.Size()));
+				dirs.insert(loc.parent_path());
+				items.push_back({item, std::move(loc), replace});
+			}
+		}
+		for (auto& path : dirs)
+			fs::create_directories(path);
+
+		auto extract = [&items](size_t begin, size_t end, auto& buf) {
+			for (auto i = begin; i < end; ++i) {
+				auto& [item, path, replace] = items[i];
+				if (replace)
+					fs::remove(path);
+				Extract(item, path, buf);
+			}
+		};
+		if (threads == 1) {
+			std::vector<uint8_t> buf;
+			extract(0, items.size(), buf);
+			return;
+		}
+		// Each worker reuses its own buffer; the decompressor keeps a context
+		// per thread decompressing at once.
+		std::vector<std::vector<uint8_t>> bufs;
+		std::mutex mtx;
+		std::exception_ptr error;
+		{
+			ThreadPool pool{threads};
+			bufs.resize(pool.Size());
+			for (size_t i = 0; i < items.size(); i += extractBatch) {
+				pool.Submit([&, i](unsigned worker) {
+					{
+						std::lock_guard lock{mtx};
+						if (error)
+							return;
+					}
+					try {
+						extract(i, std::min(i + extractBatch, items.size()), bufs[worker]);
+					} catch (...) {
+						std::lock_guard lock{mtx};
+						if (!error)
+							error = std::current_exception();
+					}
+				});
 			}
 		}
+		if (error)
+			std::rethrow_exception(error);
 	}
 
 	void Info(IDecompress& comp, const IHasher& hash) {
@@ -184,17 +322,29 @@ public:
 							const char* argv[],
 							std::ostream& out = std::cout,
 							std::ostream& err = std::cerr) {
+		constexpr auto bucketTagsArg		= "-a,--bucket-tags";
 		constexpr auto bucketFactorArg	= "-b,--bucket-factor";
+		constexpr auto headerArg				= "-c,--header";
 		constexpr auto dictArg					= "-d,--dictionary";
 		constexpr auto skipArg					= "-e,--skip-existing";
 		constexpr auto forceArg					= "-f,--force";
+		constexpr auto perfectHashArg		= "-g,--perfect-hash";
 		constexpr auto infoArg					= "-i,--info";
+		constexpr auto threadsArg				= "-j,--threads";
+		constexpr auto nameTableArg			= "-k,--name-table";
 		constexpr auto oneFileArg				= "-o,--onefile";
 		constexpr auto compLevelArg			= "-l,--level";
+		constexpr auto manifestArg			= "-m,--manifest";
+		constexpr auto lookupIndexArg		= "-n,--index";
+		constexpr auto previousArg			= "-p,--previous";
 		constexpr auto rebuildDictArg		= "-r,--rebuild-dictionary";
 		constexpr auto strategyArg			= "-s,--strategy";
 		constexpr auto dictSizeRatioArg = "-t,--dictionary-ratio";
+		constexpr auto deduplicateArg		= "-u,--deduplicate";
 		constexpr auto decompArg				= "-x,--decompress";
+		constexpr auto namespaceArg			= "--namespace";
+		constexpr auto chunkSizeArg			= "--chunk-size";
+		constexpr auto storeArg					= "-z,--store";
 
 		// Positionals, these aren't true args.
 		constexpr auto fileArg = "file";
@@ -269,6 +419,75 @@ public:
 									 "Desired dictionary size. 0.01, the default, represents a "
 									 "dictionary that will be 1% of the total file size",
 									 true);
+		app.add_option(threadsArg,
+									 threads,
+									 "Number of threads to scan and compress, or extract, with. 0\n"
+									 "uses every hardware thread. The archive is identical\n"
+									 "regardless of this value.",
+									 true);
+		app.add_flag(manifestArg,
+								 manifest,
+								 "Record the size, modification time and content hash of every\n"
+								 "file so that a later build can reuse compressed data (-p).")
+				->excludes(decomp);
+		app.add_flag(deduplicateArg,
+								 deduplicate,
+								 "Store files with identical contents only once. Archives\n"
+								 "created with this option need a version of the library\n"
+								 "that supports entry aliases.")
+				->excludes(decomp);
+		app.add_flag(bucketTagsArg,
+								 bucketTags,
+								 "Store a hash tag per file at the start of each bucket so that\n"
+								 "lookups only compare the names of likely matches.")
+				->excludes(decomp);
+		app.add_flag(lookupIndexArg,
+								 lookupIndex,
+								 "Store a compact index of every file's name, hash and location\n"
+								 "apart from the file data so that lookups touch fewer pages.")
+				->excludes(decomp);
+		app.add_flag(nameTableArg,
+								 nameTable,
+								 "Store every file name once, sorted and front-coded. The\n"
+								 "lookup index (-n) then refers to these instead of copies.")
+				->excludes(decomp);
+		app.add_flag(perfectHashArg,
+								 perfectHash,
+								 "Store a minimal perfect hash of every file name so that\n"
+								 "looking up a file never walks a bucket.")
+				->excludes(decomp);
+		auto* headerOpt =
+				app.add_option(
+							 headerArg,
+							 header,
+							 "Also generate a C++ header declaring a constexpr AssetId for\n"
+							 "every file, which loads it without hashing its name.")
+						->excludes(decomp);
+		app.add_option(namespaceArg,
+									 headerNamespace,
+									 "The namespace of the generated header (-c).",
+									 true)
+				->needs(headerOpt);
+		app.add_option(chunkSizeArg,
+									 chunkSize,
+									 "Compress files larger than this many bytes in chunks of this\n"
+									 "size so that parts of them can be read without decompressing\n"
+									 "the whole file. 0 (the default) disables chunking.")
+				->excludes(decomp);
+		app.add_flag(storeArg,
+								 store,
+								 "Store files that barely compress (such as images or audio)\n"
+								 "as-is so that reading them needs no decompression.")
+				->excludes(decomp);
+		app.add_option(
+					 previousArg,
+					 previous,
+					 "Incrementally rebuild from a previous archive created with -m\n"
+					 "and the same compression settings and dictionary. Unchanged\n"
+					 "files are copied rather than compressed again. May be the same\n"
+					 "file as the archive being created (requires -f). Implies -m.")
+				->excludes(decomp)
+				->check(CLI::ExistingFile);
 		app.add_option(oneFileArg,
 									 oneFile,
 									 "Extract a single file by name into [dir]",
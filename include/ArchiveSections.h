@@ -0,0 +1,101 @@
+#ifndef LIBASSETMAP_ARCHIVESECTIONS_H
+#define LIBASSETMAP_ARCHIVESECTIONS_H
+
+#include "IArchiveWriter.h"
+#include "MemOps.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// clang-format off
+//! \file ArchiveSections.h
+//! \brief Optional sections appended to the end of an archive.
+/*! \verbatim
+An archive whose final byte is 2 carries a table of optional sections in
+place of the trailing dictionary described in DirectoryMetadata.h. Buckets
+and entries are unchanged so anything that walks them keeps working.
+
+Each section starts at an offset aligned to sizeof(lam_size_t). The table
+follows the last section and consists of one record per section:
+
++-------------+---------------------+-------------------+
+| [id] uint32 | [offset] lam_size_t | [size] lam_size_t |
++-------------+---------------------+-------------------+
+
+after which the number of records is stored as a lam_size_t and then the
+version byte (2). If a dictionary is in use, it is stored as the Dictionary
+section. Unknown section IDs are ignored by readers.
+\endverbatim
+*/
+// clang-format on
+
+namespace AssetMap {
+	//! \brief Identifies an optional section of an archive.
+	enum class SectionId : uint32_t {
+		Dictionary	= 1,
+		Manifest		= 2,
+		Features		= 3,
+		PerfectHash = 4,
+		Fingerprint = 5,
+		LookupIndex = 6,
+		Names				= 7,
+	};
+
+	//! \brief The value of the final byte of an archive carrying sections.
+	constexpr uint8_t sectionedArchive = 2;
+
+	//! \brief Locates sections within a complete archive.
+	class ArchiveSections {
+		const uint8_t* begin = nullptr;
+		const uint8_t* table = nullptr;
+		lam_size_t count		 = 0;
+
+	public:
+		//! The size in bytes of one record of the section table.
+		static constexpr size_t recordSize =
+				sizeof(uint32_t) + sizeof(lam_size_t) * 2;
+
+		//! \brief Constructs an instance with no sections.
+		ArchiveSections() noexcept = default;
+
+		//! \brief      Reads the section table of an archive.
+		//! \post       If the archive does not carry sections, Find() always
+		//!             fails.
+		//! \param data A pointer to the start of the archive.
+		//! \param len  The size of the archive in bytes.
+		ArchiveSections(const uint8_t* data, size_t len) noexcept;
+
+		//! \brief    Finds a section by its ID.
+		//! \param id The section to look for.
+		//! \return   A pointer to the section and its size, or nullptr and 0 if
+		//!           the archive does not contain it.
+		[[nodiscard]] std::pair<const uint8_t*, size_t>
+				Find(SectionId id) const noexcept;
+
+		//! \return The offset of the first section, or of the section table if
+		//!         there are none. 0 if the archive does not carry sections.
+		[[nodiscard]] size_t Start() const noexcept;
+	};
+
+	//! \brief Accumulates sections and appends them to an archive.
+	class SectionWriter {
+		std::vector<std::pair<SectionId, std::vector<uint8_t>>> sections;
+
+	public:
+		//! \brief      Queues a section to be written.
+		//! \param id   The ID of the section. Each ID should be added once.
+		//! \param data The contents of the section.
+		void Add(SectionId id, std::vector<uint8_t> data);
+
+		//! \return Whether any section has been queued.
+		[[nodiscard]] bool Empty() const noexcept;
+
+		//! \brief     Writes every queued section, the section table and the
+		//!            version byte to \c out.
+		//! \param out The writer, positioned at the end of the last bucket.
+		void WriteTo(IArchiveWriter& out) const;
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_ARCHIVESECTIONS_H
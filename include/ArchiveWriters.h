@@ -0,0 +1,63 @@
+#ifndef LIBASSETMAP_ARCHIVEWRITERS_H
+#define LIBASSETMAP_ARCHIVEWRITERS_H
+
+#include "IArchiveWriter.h"
+#include "IMemMapper.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace AssetMap {
+	//! \brief Writes an archive directly into an IMemMapper.
+	//!
+	//! The mapping is grown geometrically as data arrives and truncated to the
+	//! exact archive size by Finish().
+	class MappedWriter : public IArchiveWriter {
+		IMemMapper& file;
+		size_t size = 0;
+
+		void Reserve(size_t len);
+
+	public:
+		//! \param file An IMemMapper which can (and will) be resized. Existing
+		//!             data will be destroyed.
+		explicit MappedWriter(IMemMapper& file);
+
+		void Write(const uint8_t* data, size_t len) override;
+
+		void Overwrite(size_t offset, const uint8_t* data, size_t len) override;
+
+		void Finish() override;
+
+		[[nodiscard]] size_t Size() const noexcept override;
+	};
+
+	//! \brief Streams an archive sequentially to a file through a large buffer.
+	//!
+	//! Unlike MappedWriter, the file never grows beyond the final archive size
+	//! and no address space is reserved for it. Only the bucket table is
+	//! revisited once all entries have been written.
+	class StreamWriter : public IArchiveWriter {
+		std::unique_ptr<char[]> buffer;
+		std::ofstream out;
+		size_t size = 0;
+
+	public:
+		//! \param file       The file to create. It is truncated if it exists.
+		//! \param bufferSize The size of the write buffer in bytes.
+		//! \throws           std::runtime_error if the file cannot be opened.
+		explicit StreamWriter(const std::filesystem::path& file,
+													size_t bufferSize = 1 << 20);
+
+		void Write(const uint8_t* data, size_t len) override;
+
+		void Overwrite(size_t offset, const uint8_t* data, size_t len) override;
+
+		void Finish() override;
+
+		[[nodiscard]] size_t Size() const noexcept override;
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_ARCHIVEWRITERS_H
@@ -0,0 +1,94 @@
+#ifndef LIBASSETMAP_ASSETCACHE_H
+#define LIBASSETMAP_ASSETCACHE_H
+
+#include "AssetId.h"
+#include "MemMappedArchive.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace AssetMap {
+	//! \brief Keeps recently decompressed entries of an archive in memory.
+	//!
+	//! Entries are cached by the location of their data, so aliases of the same
+	//! data share one copy. The cache is split into shards, each with its own
+	//! lock and an equal part of the byte budget, and each shard evicts its
+	//! least recently used entries first. Buffers are reference-counted and
+	//! remain valid after eviction until the last reference is dropped.
+	class AssetCache {
+	public:
+		//! A decompressed entry and its size.
+		using Buffer = std::pair<std::shared_ptr<const uint8_t[]>, size_t>;
+
+		//! \brief Counters describing how effective the cache is.
+		struct Stats {
+			//! Retrievals served from the cache.
+			uint64_t hits = 0;
+			//! Retrievals that decompressed the entry.
+			uint64_t misses = 0;
+			//! Entries removed to stay within the budget.
+			uint64_t evictions = 0;
+			//! The number of entries currently cached.
+			size_t entries = 0;
+			//! The decompressed size of every entry currently cached.
+			size_t bytes = 0;
+		};
+
+	private:
+		struct Shard {
+			std::mutex mtx;
+			// Most recently used first.
+			std::list<std::pair<const uint8_t*, Buffer>> lru;
+			std::unordered_map<const uint8_t*, decltype(lru)::iterator> entries;
+			size_t bytes = 0;
+			Stats stats;
+		};
+
+		const MemMappedArchive& archive;
+		size_t shardBudget;
+		std::vector<Shard> shards;
+
+		[[nodiscard]] Shard& ShardOf(const uint8_t* key) noexcept;
+
+	public:
+		//! \brief         Creates an empty cache.
+		//! \pre           The archive's decompressor must support concurrent use,
+		//!                as ZSTD does, if the cache is used by several threads.
+		//! \param archive The archive to read from. Must outlive this instance.
+		//! \param budget  The maximum total size of the cached entries. Entries
+		//!                larger than \c budget divided by \c shards are never
+		//!                cached.
+		//! \param shards  The number of independently locked parts of the cache.
+		//!                Rounded up to a power of 2.
+		AssetCache(const MemMappedArchive& archive,
+							 size_t budget,
+							 unsigned shards = 16);
+
+		//! \brief    Retrieves an entry, decompressing it if it is not cached.
+		//! \pre      \c id must refer to an entry of the archive.
+		//! \param id The entry to retrieve.
+		//! \return   The entry's contents. If decompressing fails, the pointer is
+		//!           null.
+		[[nodiscard]] Buffer Retrieve(AssetId id);
+
+		//! \brief      Retrieves an entry by name.
+		//! \param name The name of the entry.
+		//! \return     The entry's contents. The pointer is null if the entry
+		//!             does not exist or could not be decompressed.
+		[[nodiscard]] Buffer Retrieve(std::string_view name);
+
+		//! \return The counters of every shard added together.
+		[[nodiscard]] Stats Statistics();
+
+		//! \brief Removes every entry. Counters are kept.
+		void Clear();
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_ASSETCACHE_H
@@ -0,0 +1,38 @@
+#ifndef LIBASSETMAP_ASSETHEADER_H
+#define LIBASSETMAP_ASSETHEADER_H
+
+#include "MemMappedArchive.h"
+
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace AssetMap {
+	//! \brief      Converts an entry name into a C++ identifier.
+	//!
+	//! Letters are upper-cased and each run of anything that is not a letter
+	//! or digit becomes a single underscore, so "path/to/file.txt" becomes
+	//! PATH_TO_FILE_TXT. Identifiers that would begin with a digit or an
+	//! underscore are prefixed with ASSET_ or ASSET, keeping clear of reserved
+	//! identifiers.
+	//! \param name The name of an entry.
+	//! \return     An identifier that may collide with that of another name.
+	[[nodiscard]] std::string AssetIdentifier(std::string_view name);
+
+	//! \brief           Writes a C++ header declaring a constexpr AssetId for
+	//!                  every entry of an archive along with its fingerprint.
+	//!
+	//! Identifiers are generated by AssetIdentifier() in name order; any that
+	//! collide have a numeric suffix appended. Each ID is documented with the
+	//! entry's name, quoted and escaped like a string literal.
+	//! \pre             The archive must have a fingerprint.
+	//! \throw           std::runtime_error if the archive has no fingerprint.
+	//! \param archive   The archive the IDs refer to.
+	//! \param out       The stream to write the header to.
+	//! \param nameSpace The namespace to declare the IDs in.
+	void WriteAssetHeader(const MemMappedArchive& archive,
+												std::ostream& out,
+												std::string_view nameSpace);
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_ASSETHEADER_H
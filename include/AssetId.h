@@ -0,0 +1,19 @@
+#ifndef LIBASSETMAP_ASSETID_H
+#define LIBASSETMAP_ASSETID_H
+
+#include "MemOps.h"
+
+#include <cstdint>
+
+namespace AssetMap {
+	//! \brief Identifies an entry of one specific archive without its name.
+	//!
+	//! Asset IDs are generated alongside an archive (see AssetHeader.h) and are
+	//! only valid for the archive whose fingerprint they were generated with.
+	struct AssetId {
+		//! The offset of the entry from the start of the archive.
+		lam_size_t offset;
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_ASSETID_H
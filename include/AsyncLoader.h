@@ -0,0 +1,119 @@
+#ifndef LIBASSETMAP_ASYNCLOADER_H
+#define LIBASSETMAP_ASYNCLOADER_H
+
+#include "AssetId.h"
+#include "MemMappedArchive.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace AssetMap {
+	//! \brief Identifies a request queued on an AsyncLoader.
+	struct LoadTicket {
+		uint64_t id;
+	};
+
+	//! \brief Reads entries of an archive on background threads.
+	//!
+	//! Requests are served highest priority first and in submission order
+	//! within a priority, so urgent loads overtake queued background
+	//! prefetches. A request can be cancelled until a worker starts reading it.
+	//! The total decompressed size of the entries being read at once is bounded
+	//! to limit memory use; an entry larger than the bound is read on its own.
+	class AsyncLoader {
+	public:
+		//! Receives the outcome of a request on the worker that read it.
+		using Callback = std::function<void(BatchResult)>;
+
+	private:
+		struct Request {
+			BatchRequest request;
+			int64_t rank = 0;
+			size_t size	 = 0;
+			Callback done;
+		};
+
+		const MemMappedArchive& archive;
+		size_t budget;
+		size_t inFlight		 = 0;
+		uint64_t nextTicket = 0;
+		bool stopping			 = false;
+		// Ordered by rank (the negated priority), then ticket.
+		std::set<std::pair<int64_t, uint64_t>> order;
+		std::map<uint64_t, Request> pending;
+		std::mutex mtx;
+		std::condition_variable cv;
+		std::vector<std::thread> threads;
+
+		void Run() noexcept;
+
+		[[nodiscard]] bool Ready() const noexcept;
+
+		static BatchResult Cancelled();
+
+		static void Complete(Request& req, BatchResult result) noexcept;
+
+	public:
+		//! \brief         Starts the workers.
+		//! \pre           The archive's decompressor must support concurrent use,
+		//!                as ZSTD does, if \c threads is not 1.
+		//! \param archive The archive to read from. Must outlive this instance.
+		//! \param threads The number of workers. 0 selects one per hardware
+		//!                thread.
+		//! \param budget  The maximum number of decompressed bytes being read at
+		//!                once. 0 places no limit.
+		explicit AsyncLoader(const MemMappedArchive& archive,
+												 unsigned threads = 0,
+												 size_t budget		= 0);
+
+		AsyncLoader(const AsyncLoader&) = delete;
+
+		AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+		//! \brief          Queues an entry to be read.
+		//! \param request  The entry to read and, optionally, where to read it to.
+		//!                 A supplied buffer must remain valid until the request
+		//!                 completes.
+		//! \param priority Requests with a higher priority are read first.
+		//! \param done     Called exactly once with the outcome, from a worker
+		//!                 thread, or from Cancel() or the destructor if the
+		//!                 request never started. Anything it throws is
+		//!                 discarded.
+		//! \return         A ticket with which to cancel the request.
+		//! \throws         std::invalid_argument if \c done is empty.
+		LoadTicket Load(const BatchRequest& request, int priority, Callback done);
+
+		//! \brief          Queues an entry to be read.
+		//! \param request  As for Load(const BatchRequest&, int, Callback).
+		//! \param priority Requests with a higher priority are read first.
+		//! \return         A ticket with which to cancel the request and the
+		//!                 eventual outcome.
+		std::pair<LoadTicket, std::future<BatchResult>>
+				Load(const BatchRequest& request, int priority = 0);
+
+		//! \brief        Removes a request from the queue if it has not started.
+		//!
+		//! A cancelled request completes with an error.
+		//! \param ticket The request to cancel.
+		//! \return       Whether the request was cancelled. False if it had
+		//!               already started, completed or been cancelled.
+		bool Cancel(LoadTicket ticket);
+
+		//! \return The number of requests waiting to be started.
+		[[nodiscard]] size_t Pending();
+
+		//! \brief Cancels every request that has not started and waits for the
+		//!        rest to complete.
+		~AsyncLoader() noexcept;
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_ASYNCLOADER_H
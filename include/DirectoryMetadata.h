@@ -77,12 +77,18 @@ namespace AssetMap {
 		//! The constructor will iterate through the directory passed and compute
 		//! all necessary data required to archive it. Iteration is recursive and
 		//! anything that is not a regular file will be ignored.
-		//! \param hasher Any implementation satisfying IHasher.
-		//! \param comp   Any implementation satisfying ICompress.
+		//! Files are ordered by name within each bucket regardless of the order
+		//! in which the filesystem returns them.
+		//! \param hasher  Any implementation satisfying IHasher.
+		//! \param comp    Any implementation satisfying ICompress.
 		//! \param ent 		An entry that references a valid, readable directory.
+		//! \param threads The number of threads to scan with. Subdirectories are
+		//!                spread across them. 0 uses every hardware thread. The
+		//!                result is identical regardless of this value.
 		explicit DirectoryMetadata(const IHasher& hasher,
 															 ICompress& comp,
-															 const std::filesystem::directory_entry& ent);
+															 const std::filesystem::directory_entry& ent,
+															 unsigned threads = 1);
 
 		//! \brief Obtain the worst-case required space to compress the directory
 		//! 			 passed to the constructor for the given hash and compression algo
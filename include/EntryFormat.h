@@ -0,0 +1,105 @@
+#ifndef LIBASSETMAP_ENTRYFORMAT_H
+#define LIBASSETMAP_ENTRYFORMAT_H
+
+#include <cstdint>
+
+// clang-format off
+//! \file EntryFormat.h
+//! \brief Optional extensions to the layout of archive entries.
+/*! \verbatim
+Archive-wide features are stored as a little-endian uint32 bitmask in the
+Features section (see ArchiveSections.h). An archive without that section
+has no features and is laid out exactly as described in DirectoryMetadata.h.
+
+featureEntryFlags: every entry other than the terminator of a bucket carries
+a single flags byte directly after the \0 of its name. The size prefix
+includes it:
+
++-------------------+------------------+--------------+-----------+-----------+
+| [size] lam_size_t | [name] "file\0"  | [flags] byte | [data]... | [padding] |
++-------------------+------------------+--------------+-----------+-----------+
+
+featureBucketTags: every entry stores the length of its name in front of it
+and every bucket begins with a tag per entry. The tag is the low byte of the
+IHasher hash of the entry's name. The bucket table refers to the start of the
+tags rather than the first entry, which directly follows them:
+
++--------------------+-----------------------------+-----------+------------+
+| [count] lam_size_t | [tags] uint8 * count ...    | [padding] | entries... |
++--------------------+-----------------------------+-----------+------------+
+
++-------------------+----------------------+-----------------+--------------+
+| [size] lam_size_t | [name length] uint16 | [name] "file\0" | [flags]...   |
++-------------------+----------------------+-----------------+--------------+
+
+The size prefix includes the name length. Bucket terminators store a name
+length of 0 and are not counted.
+
+A lookup compares the tags of a bucket (16 at a time where SIMD is available)
+and only compares the names of entries whose tag matches. Every entry can be
+skipped by its size alone. The padding after the tags aligns the first entry
+to sizeof(lam_size_t).
+
+entryAlias: the entry's data is stored by an earlier entry. Its own data is a
+single lam_size_t holding the distance, in bytes, from the earlier entry to
+this one. The earlier entry is never an alias itself.
+
+entryStored: the entry's data is the file's contents as-is rather than the
+output of the compressor. An alias of a stored entry is not itself marked as
+stored.
+
+featureChunks: entries may carry the entryChunked flag, in which case the
+file was split into chunks that were compressed independently so that any
+part of it can be read without decompressing the rest:
+
++-------------------------+-------------------+------------------------------+
+| [chunk size] lam_size_t | [size] lam_size_t | [ends] lam_size_t * count... |
++-------------------------+-------------------+------------------------------+
+| [chunks] ...                                                               |
++----------------------------------------------------------------------------+
+
+Every chunk but the last decompresses to exactly chunk size bytes and size is
+the size of the whole file, so count is size / chunk size rounded up. Each
+end is the offset just past a compressed chunk, relative to the first chunk.
+An alias of a chunked entry is not itself marked as chunked. Chunked entries
+are never stored.
+\endverbatim
+*/
+// clang-format on
+
+namespace AssetMap {
+	//! \brief Every entry carries a flags byte after its name.
+	constexpr uint32_t featureEntryFlags = 1u << 0;
+
+	//! \brief Buckets carry a tag per entry and entries their name's length.
+	constexpr uint32_t featureBucketTags = 1u << 1;
+
+	//! \brief Entries may be split into independently compressed chunks.
+	//!        Implies featureEntryFlags.
+	constexpr uint32_t featureChunks = 1u << 2;
+
+	//! \brief Every feature understood by this version of the library.
+	constexpr uint32_t knownFeatures =
+			featureEntryFlags | featureBucketTags | featureChunks;
+
+	//! \brief The entry's data is shared with an earlier entry.
+	constexpr uint8_t entryAlias = 1u << 0;
+
+	//! \brief The entry's data is stored uncompressed.
+	constexpr uint8_t entryStored = 1u << 1;
+
+	//! \brief The entry's data is a sequence of independently compressed
+	//!        chunks.
+	constexpr uint8_t entryChunked = 1u << 2;
+
+	//! \brief      Computes the tag of an entry for featureBucketTags.
+	//! \param hash The IHasher hash of the entry's name.
+	//! \return     The tag.
+	constexpr uint8_t EntryTag(uint64_t hash) noexcept {
+		// The high bits usually select the bucket, so all entries of a bucket
+		// tend to share them.
+		return static_cast<uint8_t>(hash);
+	}
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_ENTRYFORMAT_H
@@ -18,6 +18,7 @@ namespace AssetMap {
 		//! \brief Compute the hash of a given string of bytes.
 		//! \param data A string of data to digest.
 		//! \return A 64-bit hash computed by CityHash.
+		//! \see StaticCityHash() for computing the same hash at compile time.
 		[[nodiscard]] uint64_t Hash(std::string_view data) const noexcept override;
 
 		//! \brief Calculates the bucket to index given a hash and total bucket
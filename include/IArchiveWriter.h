@@ -0,0 +1,38 @@
+#ifndef LIBASSETMAP_IARCHIVEWRITER_H
+#define LIBASSETMAP_IARCHIVEWRITER_H
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace AssetMap {
+	class IArchiveWriter {
+	public:
+		//! \brief      Appends data to the end of the archive.
+		//! \param data A pointer to at least \c len bytes.
+		//! \param len  The number of bytes to append.
+		//! \throws     std::runtime_error if the data could not be written.
+		virtual void Write(const uint8_t* data, size_t len) = 0;
+
+		//! \brief        Replaces data that has already been written.
+		//!
+		//! This is used to fill in the bucket table once all entries are known.
+		//! \pre          \c offset + \c len must not exceed Size().
+		//! \param offset The offset (from the start of the archive) to write at.
+		//! \param data   A pointer to at least \c len bytes.
+		//! \param len    The number of bytes to replace.
+		//! \throws       std::runtime_error if the data could not be written.
+		virtual void Overwrite(size_t offset, const uint8_t* data, size_t len) = 0;
+
+		//! \brief  Completes the archive. No further calls may be made except to
+		//!         Size() and the destructor.
+		//! \throws std::runtime_error if the archive could not be completed.
+		virtual void Finish() = 0;
+
+		//! \return The number of bytes written so far.
+		[[nodiscard]] virtual size_t Size() const noexcept = 0;
+
+		virtual ~IArchiveWriter() noexcept = default;
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_IARCHIVEWRITER_H
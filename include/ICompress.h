@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <cstdlib>
 #include <filesystem>
+#include <memory>
+#include <string>
 #include <utility>
 
 namespace AssetMap {
@@ -62,9 +64,31 @@ namespace AssetMap {
 		//!      created by an instance of the same or compatible implementation.
 		//! \post \c dict must remain valid until all calls to \c Compress() have
 		//!       completed and no further calls are made.
+		//! \throw std::runtime_error if the dictionary cannot be loaded.
 		//! \param dict A pointer to the dictionary.
 		//! \param len
-		virtual void UseDictionary(const uint8_t* dict, size_t len) noexcept = 0;
+		virtual void UseDictionary(const uint8_t* dict, size_t len) = 0;
+
+		//! \brief Describes every setting that influences the compressed output,
+		//!        other than the dictionary.
+		//!
+		//! Two instances with equal descriptions and dictionaries must produce
+		//! identical output for the same input. This allows previously compressed
+		//! data to be reused instead of compressing it again. Implementations
+		//! without settings may rely on the default, which describes none.
+		//! \return A human-readable description of the settings.
+		[[nodiscard]] virtual std::string Settings() const {
+			return {};
+		}
+
+		//! \brief Creates an independent compressor with identical settings.
+		//!
+		//! The clone must produce byte-identical output to this instance for the
+		//! same input. It is used to compress from several threads at once since
+		//! a single instance is not required to be thread-safe.
+		//! \post Any dictionary is shared by reference and must outlive the clone.
+		//! \return A new instance configured the same as this one.
+		[[nodiscard]] virtual std::unique_ptr<ICompress> Clone() const = 0;
 
 		virtual ~ICompress() noexcept = default;
 	};
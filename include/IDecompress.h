@@ -4,11 +4,20 @@
 #include <cstdint>
 #include <cstdlib>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <stdexcept>
 #include <utility>
 
 namespace AssetMap {
 	class IDecompress {
 	public:
+		//! \brief Receives decompressed data a block at a time.
+		//!
+		//! Called with a pointer to the next block and its size, which is only
+		//! valid for the duration of the call. Returns false to stop early.
+		using Sink = std::function<bool(const uint8_t*, size_t)>;
+
 		//! \brief Decompress a previously compressed sequence of data.
 		//!
 		//! Typically, when decompressing data, a call to CalcDecompressSize() will
@@ -26,6 +35,30 @@ namespace AssetMap {
 																						uint8_t* dst,
 																						size_t dstLen) = 0;
 
+		//! \brief Decompresses data incrementally, passing it to \c sink in blocks.
+		//!
+		//! Implementations should hold only a block of output (plus whatever
+		//! history the format requires) in memory at once, regardless of how
+		//! large the decompressed data is. The default decompresses everything
+		//! into one buffer with Decompress() and passes it to \c sink at once.
+		//! \pre As for Decompress().
+		//! \param src The buffer containing compressed data.
+		//! \param srcLen The length of the source data.
+		//! \param sink Receives each block of decompressed data in order.
+		//! \return The number of bytes passed to \c sink.
+		//! \throws std::runtime_error if the data could not be decompressed.
+		virtual size_t
+				DecompressStream(const uint8_t* src, size_t srcLen, const Sink& sink) {
+			auto len = CalcDecompressSize(src, srcLen);
+			if (len == 0)
+				return 0;
+			std::unique_ptr<uint8_t[]> buf{new uint8_t[len]};
+			if (Decompress(src, srcLen, buf.get(), len) != len)
+				throw std::runtime_error{"Decompression failed"};
+			sink(buf.get(), len);
+			return len;
+		}
+
 		//! \brief Calculate the number of bytes required to decompress some data.
 		//! \pre \c src must point to a sequence of data previously created by a
 		//!      compatible ICompress implementation. If the input data was
@@ -48,9 +81,10 @@ namespace AssetMap {
 		//!        implementation.
 		//! \post  \c dict must remain valid until all calls to \c Decompress() have
 		//!        completed and no further will be issued to this instance.
+		//! \throw std::runtime_error if the dictionary cannot be loaded.
 		//! \param dict The dictionary to load.
 		//! \param len The size of the dictionary, in bytes.
-		virtual void UseDictionary(const uint8_t* dict, size_t len) noexcept = 0;
+		virtual void UseDictionary(const uint8_t* dict, size_t len) = 0;
 
 		virtual ~IDecompress() noexcept = default;
 	};
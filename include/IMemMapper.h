@@ -1,12 +1,56 @@
 #ifndef LIBASSETMAP_IMEMMAPPER_H
 #define LIBASSETMAP_IMEMMAPPER_H
 
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 
 namespace AssetMap {
+	//! \brief Optional behaviour when opening an existing file for reading.
+	struct MapOptions {
+		//! Read the whole file in while opening it so that no access ever waits
+		//! for a page to be read from disk.
+		bool populate = false;
+
+		//! Lock the whole mapping into memory so that it is never paged out.
+		//! Subject to the process' limit on locked memory (RLIMIT_MEMLOCK or the
+		//! working set size on Windows). \see MapStats::locked
+		bool lock = false;
+
+		//! Ask for the mapping to be backed by huge pages where the system
+		//! supports this for files, reducing TLB misses on large archives.
+		bool hugePages = false;
+	};
+
+	//! \brief What happened whilst opening a file with MapOptions.
+	struct MapStats {
+		//! How long mapping the file took, including populating and locking it.
+		std::chrono::nanoseconds openTime{};
+
+		//! Whether the whole file was read in.
+		bool populated = false;
+
+		//! Whether the whole mapping was locked into memory.
+		bool locked = false;
+
+		//! Whether huge pages were successfully requested. The system may still
+		//! use regular pages.
+		bool hugePages = false;
+	};
+
 	class IMemMapper {
 	public:
+		//! \brief How the mapped data is expected to be accessed.
+		enum class Access
+		{
+			//! No particular pattern. The default.
+			Normal,
+			//! In no particular order, so reading ahead is wasted effort.
+			Random,
+			//! From start to end, so reading far ahead pays off.
+			Sequential,
+		};
+
 		//! \brief       Resize a mapped file.
 		//! \param  size Desired size. Can be larger or smaller. Must be > 0
 		//! \throws      std::runtime_error for any implementation-defined failure.
@@ -35,6 +79,56 @@ namespace AssetMap {
 		//! 			  but not including the address at Get() + Size()
 		[[nodiscard]] virtual uint8_t* Get() noexcept = 0;
 
+		//! \brief  Whether data only becomes accessible through Get() once Read()
+		//!         has been called for it.
+		//!
+		//! The default is false: everything is accessible once the file is open.
+		//! \return Whether Read() must be called before accessing data.
+		[[nodiscard]] virtual bool OnDemand() const noexcept {
+			return false;
+		}
+
+		//! \brief        Makes part of the data accessible through Get(), reading
+		//!               it in first if necessary.
+		//!
+		//! Only needed if OnDemand(). The default implementation does nothing.
+		//! Implementations must allow concurrent calls.
+		//! \param offset The offset of the first byte to make accessible.
+		//! \param len    The number of bytes to make accessible. Clamped to the end
+		//!               of the data.
+		//! \return       Whether the range is now accessible.
+		virtual bool Read([[maybe_unused]] size_t offset,
+											[[maybe_unused]] size_t len) noexcept {
+			return true;
+		}
+
+		//! \brief        Hints how the whole mapping will be accessed.
+		//!
+		//! Purely advisory. The default implementation does nothing.
+		//! \param access The expected access pattern.
+		virtual void Advise([[maybe_unused]] Access access) noexcept {}
+
+		//! \brief        Hints that part of the mapping will be read soon so that
+		//!               it can be read in ahead of time without blocking.
+		//!
+		//! Purely advisory. The default implementation does nothing.
+		//! \param offset The offset of the first byte that will be needed.
+		//! \param len    The number of bytes that will be needed.
+		virtual void WillNeed([[maybe_unused]] size_t offset,
+													[[maybe_unused]] size_t len) noexcept {}
+
+		//! \brief        Locks part of the mapping into memory so that it is never
+		//!               paged out, e.g. the parts of an archive used for lookups.
+		//!
+		//! The default implementation does nothing.
+		//! \param offset The offset of the first byte to lock.
+		//! \param len    The number of bytes to lock.
+		//! \return       Whether the range is now locked.
+		virtual bool Lock([[maybe_unused]] size_t offset,
+											[[maybe_unused]] size_t len) noexcept {
+			return false;
+		}
+
 		virtual ~IMemMapper() noexcept = default;
 	};
 } // namespace AssetMap
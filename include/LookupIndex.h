@@ -0,0 +1,115 @@
+#ifndef LIBASSETMAP_LOOKUPINDEX_H
+#define LIBASSETMAP_LOOKUPINDEX_H
+
+#include "MemOps.h"
+#include "NameTable.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// clang-format off
+//! \file LookupIndex.h
+//! \brief A compact index of every entry, stored apart from the entries.
+/*! \verbatim
+Stored as the LookupIndex section (see ArchiveSections.h). It mirrors the
+bucket table but keeps everything a lookup needs together so that only the
+entry that is finally read is touched outside of it:
+
++----------------------+--------------------+-------------------------+
+| [buckets] lam_size_t | [count] lam_size_t | [names size] lam_size_t |
++----------------------+--------------------+-------------------------+
+| [heads] lam_size_t * (buckets + 1) ...                              |
++---------------------------------------------------------------------+
+| [records] * count ...                                               |
++---------------------------------------------------------------------+
+| [names] char * names size ...                                       |
++---------------------------------------------------------------------+
+
+Each record is laid out as:
+
++--------------+--------------------+--------------------------+
+| [tag] uint32 | [entry] lam_size_t | [name offset] lam_size_t |
++--------------+--------------------+--------------------------+
+
+The records of bucket N are those from heads[N] up to heads[N + 1]. tag holds
+the low 32 bits of the IHasher hash of the entry's name and entry is its
+offset from the start of the archive. Names are stored back to back without
+terminators in record order, so the length of a name is the distance to the
+next name (or the end of the names).
+
+If names size is 0, the names are instead kept once in the Names section (see
+NameTable.h) and name offset holds the ordinal of the entry's name there.
+\endverbatim
+*/
+// clang-format on
+
+namespace AssetMap {
+	//! \brief Reads and writes the LookupIndex section of an archive.
+	class LookupIndex {
+		const uint8_t* heads	 = nullptr;
+		const uint8_t* records = nullptr;
+		const uint8_t* names	 = nullptr;
+		lam_size_t buckets		 = 0;
+		lam_size_t count			 = 0;
+		lam_size_t namesSize	 = 0;
+
+		[[nodiscard]] std::string_view Name(lam_size_t record) const noexcept;
+
+	public:
+		//! \brief Describes an entry to be indexed.
+		struct Record {
+			//! The bucket the entry is stored in.
+			lam_size_t bucket;
+			//! The IHasher hash of the entry's name.
+			uint64_t hash;
+			//! The offset of the entry from the start of the archive.
+			lam_size_t entry;
+			//! The name of the entry.
+			std::string name;
+			//! The ordinal of the name in the Names section, if there is one.
+			lam_size_t ordinal = 0;
+		};
+
+		//! \brief Constructs an empty index.
+		LookupIndex() noexcept = default;
+
+		//! \brief      Constructs an index over a LookupIndex section.
+		//! \param data A pointer to the section or nullptr if it is absent.
+		//! \param len  The size of the section.
+		LookupIndex(const uint8_t* data, size_t len) noexcept;
+
+		//! \brief        Finds an entry by name.
+		//! \pre          The index must not be empty.
+		//! \param name   The name of the entry.
+		//! \param hash   The IHasher hash of \c name.
+		//! \param bucket The bucket \c name belongs to.
+		//! \param table  The archive's Names section, which is used if the index
+		//!               does not store names itself.
+		//! \return       The offset of the entry, if it exists.
+		[[nodiscard]] std::optional<lam_size_t>
+				Find(std::string_view name,
+						 uint64_t hash,
+						 lam_size_t bucket,
+						 const NameTable& table) const noexcept;
+
+		//! \return Whether this instance refers to an index.
+		explicit operator bool() const noexcept;
+
+		//! \brief         Encodes a LookupIndex section.
+		//! \pre           \c records must be sorted by bucket.
+		//! \param buckets The number of buckets in the archive.
+		//! \param records One record per entry.
+		//! \param shared  Refer to names in the Names section by their ordinal
+		//!                rather than storing them.
+		//! \return        The contents of the section.
+		[[nodiscard]] static std::vector<uint8_t>
+				Encode(lam_size_t buckets,
+							 const std::vector<Record>& records,
+							 bool shared = false);
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_LOOKUPINDEX_H
@@ -0,0 +1,82 @@
+#ifndef LIBASSETMAP_MANIFEST_H
+#define LIBASSETMAP_MANIFEST_H
+
+#include "MemOps.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// clang-format off
+//! \file Manifest.h
+//! \brief Records describing the source files an archive was built from.
+/*! \verbatim
+Stored as the Manifest section (see ArchiveSections.h):
+
++-------------------+-------------------+-----------------------------+
+| [settings] uint64 | [count] lam_size_t | [records] * count ...      |
++-------------------+-------------------+-----------------------------+
+
+Each record is laid out as:
+
++--------------------+---------------+-------------------+-----------------+
+| [entry] lam_size_t | [size] uint64 | [modified] int64  | [hash] uint64   |
++--------------------+---------------+-------------------+-----------------+
+
+Records are sorted by the offset of the entry they describe. settings is a
+hash of the compressor settings and dictionary used to build the archive.
+\endverbatim
+*/
+// clang-format on
+
+namespace AssetMap {
+	//! \brief Describes the source file of a single archive entry.
+	struct SourceRecord {
+		//! The offset of the entry from the start of the archive.
+		lam_size_t entry = 0;
+		//! The uncompressed size of the file.
+		uint64_t size = 0;
+		//! The file's last write time as a count of filesystem clock ticks.
+		int64_t modified = 0;
+		//! The IHasher hash of the file's contents.
+		uint64_t contentHash = 0;
+	};
+
+	//! \brief Reads the manifest section of an archive.
+	class Manifest {
+		const uint8_t* records = nullptr;
+		lam_size_t count			 = 0;
+		uint64_t settings			 = 0;
+
+	public:
+		//! \brief Constructs an empty manifest.
+		Manifest() noexcept = default;
+
+		//! \brief      Constructs a manifest over a Manifest section.
+		//! \param data A pointer to the section or nullptr if it is absent.
+		//! \param len  The size of the section.
+		Manifest(const uint8_t* data, size_t len) noexcept;
+
+		//! \return The hash of the settings the archive was compressed with.
+		[[nodiscard]] uint64_t Settings() const noexcept;
+
+		//! \brief        Looks up the record for an entry.
+		//! \param offset The offset of the entry from the start of the archive.
+		//! \return       The record, if the manifest has one for this entry.
+		[[nodiscard]] std::optional<SourceRecord>
+				Find(lam_size_t offset) const noexcept;
+
+		//! \return Whether this instance refers to a manifest section.
+		explicit operator bool() const noexcept;
+
+		//! \brief          Encodes a Manifest section.
+		//! \pre            \c records must be sorted by SourceRecord::entry.
+		//! \param settings The hash of the compressor settings and dictionary.
+		//! \param records  One record per entry.
+		//! \return         The contents of the section.
+		[[nodiscard]] static std::vector<uint8_t>
+				Encode(uint64_t settings, const std::vector<SourceRecord>& records);
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_MANIFEST_H
@@ -1,27 +1,146 @@
 #ifndef LIBASSETMAP_MEMMAPPEDARCHIVE_H
 #define LIBASSETMAP_MEMMAPPEDARCHIVE_H
 
+#include "ArchiveSections.h"
+#include "AssetId.h"
+#include "IArchiveWriter.h"
 #include "ICompress.h"
 #include "IDecompress.h"
 #include "IHasher.h"
 #include "IMemMapper.h"
+#include "LookupIndex.h"
 
 #include "MemMappedBucket.h"
 #include "MemMappedBucketEntry.h"
 #include "MemOps.h"
+#include "PerfectHash.h"
 
 #include <cstdint>
+#include <exception>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 namespace AssetMap {
+	class MemMappedArchive;
+	class ThreadPool;
+
+	//! \brief One entry to be read by MemMappedArchive::RetrieveBatch().
+	struct BatchRequest {
+		//! The entry to read. \see MemMappedArchive::Resolve()
+		AssetId id;
+
+		//! Where to decompress the entry. If null, a buffer of exactly the
+		//! entry's size is allocated instead.
+		uint8_t* buffer = nullptr;
+
+		//! The size of \c buffer. Must be at least the entry's decompressed size.
+		size_t capacity = 0;
+	};
+
+	//! \brief The outcome of reading one BatchRequest.
+	struct BatchResult {
+		//! The entry's contents if no buffer was supplied, otherwise null.
+		std::unique_ptr<uint8_t[]> data;
+
+		//! The number of bytes written.
+		size_t size = 0;
+
+		//! Set if this entry could not be read, in which case \c size is 0.
+		std::exception_ptr error;
+	};
+
+	//! \brief Optional settings used when creating an archive.
+	struct BuildOptions {
+		//! Number of threads used to scan the directory and compress files. 0
+		//! selects one per hardware thread. The archive is byte-identical
+		//! regardless of this value.
+		unsigned threads = 1;
+
+		//! Store the size, modification time and content hash of every source
+		//! file so that a later build can reuse this archive's compressed data.
+		bool manifest = false;
+
+		//! A previous archive with a manifest built with the same compressor
+		//! settings and dictionary. Entries whose source size and modification
+		//! time, or size and content hash, are unchanged are copied from it
+		//! instead of being compressed again. Implies \c manifest.
+		const MemMappedArchive* previous = nullptr;
+
+		//! Store files with identical contents once. Later copies become aliases
+		//! of the first which share its compressed data. \see EntryFormat.h
+		bool deduplicate = false;
+
+		//! Store files as-is when compressing them saves less than 1/32 of their
+		//! size. Such entries can be read without decompressing or copying them.
+		//! \see MemMappedBucketEntry::Stored()
+		bool store = false;
+
+		//! Store a minimal perfect hash of every entry name. Looking up a name is
+		//! then a single hash, two table reads and one name comparison regardless
+		//! of how many entries share its bucket. \see PerfectHash.h
+		bool perfectHash = false;
+
+		//! Store a fingerprint of the names and locations of every entry so that
+		//! generated AssetId constants can be checked against the archive.
+		//! \see WriteAssetHeader()
+		bool fingerprint = false;
+
+		//! Store a tag per entry at the start of each bucket and the length of
+		//! each name so that looking up a name only compares the names of
+		//! entries with a matching tag. \see EntryFormat.h
+		bool bucketTags = false;
+
+		//! Store a compact index of every entry's hash, name and offset apart from
+		//! the entries. A lookup then only touches the index and the entry that
+		//! is read, rather than every entry before it in its bucket.
+		//! \see LookupIndex.h
+		bool lookupIndex = false;
+
+		//! Store every name once, sorted and front-coded, in a Names section. A
+		//! lookup index then refers to these names instead of storing its own
+		//! copies and List() and Glob() only read this section rather than
+		//! every entry. Entries keep their names. \see NameTable.h
+		bool nameTable = false;
+
+		//! Compress files larger than this many bytes as a sequence of chunks of
+		//! this size that can be decompressed independently, so that reading a
+		//! small part of a large file only decompresses the chunks covering it.
+		//! 0 compresses every file as a whole. \see EntryFormat.h
+		lam_size_t chunkSize = 0;
+	};
+
 	class MemMappedArchive {
 		IMemMapper& file;
+		//! \c file if it reads on demand, so that entries read themselves.
+		IMemMapper* source = nullptr;
 		const IHasher& hasher;
 		IDecompress* decomp = nullptr;
+		ArchiveSections sections;
+		uint32_t features = 0;
+		PerfectHashIndex index;
+		LookupIndex lookup;
+		NameTable names;
+
+		void LoadSections();
+
+		//! Reads the bucket table, the trailer and the sections from an
+		//! IMemMapper that reads on demand.
+		void ReadIndex();
+
+		[[nodiscard]] std::vector<std::pair<std::string, AssetId>>
+				Query(std::string_view prefix,
+							const std::function<bool(std::string_view)>& filter) const;
+
+		[[nodiscard]] std::pair<const uint8_t*, size_t> Dictionary() const noexcept;
 
 		template <class Comp>
-		void LoadDictionary(Comp& comp) noexcept;
+		void LoadDictionary(Comp& comp);
 
 		class Iterator {
 			const MemMappedArchive* archive;
@@ -47,8 +166,10 @@ namespace AssetMap {
 
 	public:
 		//! \brief        Constructs a MemMappedArchive for reading from an archive
-		//!	You should construct a separate instance of this class
-		//! along with a separate IDecompress for each thread.
+		//!	Entries may be retrieved from any number of threads at once provided
+		//! \c comp supports concurrent decompression, as ZSTD does. Otherwise,
+		//! construct a separate instance of this class along with a separate
+		//! IDecompress for each thread.
 		//! \post         Anything that causes a change to the archive may result in
 		//!               undefined behaviour. This should usually fail at the point
 		//!               of trying to write to the IMemMapper as it should have
@@ -77,11 +198,30 @@ namespace AssetMap {
 		//! \param comp 	An implementation used to compress files.
 		//! \param decomp An optional decompressor should you wish to immediately
 		//! 						  read data back.
+		//! \param options Optional build settings. When more than one thread is
+		//!               requested, \c comp is cloned once per worker.
 		MemMappedArchive(const std::filesystem::directory_entry& ent,
 										 const IHasher& hasher,
 										 IMemMapper& file,
 										 ICompress& comp,
-										 IDecompress* decomp = nullptr);
+										 IDecompress* decomp					= nullptr,
+										 const BuildOptions& options = {});
+
+		//! \brief				Writes an archive without opening it for reading.
+		//!
+		//! Compressed entries are appended to \c out in order and only the bucket
+		//! table is held in memory until the end, so pairing this with a
+		//! StreamWriter needs no more disk space than the final archive.
+		//! \param ent 		A directory which will be recursed to create the archive.
+		//! \param hasher A hasher which will be used to determine bucketing.
+		//! \param out 		The destination of the archive. Finish() is called on it.
+		//! \param comp 	An implementation used to compress files.
+		//! \param options Optional build settings.
+		static void Build(const std::filesystem::directory_entry& ent,
+											const IHasher& hasher,
+											IArchiveWriter& out,
+											ICompress& comp,
+											const BuildOptions& options = {});
 
 		//! \brief Obtains the total number of buckets in the archive.
 		//! \return The number of buckets in the archive.
@@ -97,6 +237,39 @@ namespace AssetMap {
 		//!         return 0 in such a situation.
 		[[nodiscard]] lam_size_t DictionarySize() const noexcept;
 
+		//! \brief    Obtains an optional section of the archive.
+		//! \param id The section to find.
+		//! \return   A pointer to the section and its size, or nullptr and 0 if
+		//!           the archive does not contain it.
+		[[nodiscard]] std::pair<const uint8_t*, size_t>
+				Section(SectionId id) const noexcept;
+
+		//! \brief  Obtains the fingerprint of the archive's layout.
+		//!
+		//! The fingerprint changes whenever an entry is added, removed, renamed or
+		//! moved, which invalidates any AssetId generated for the archive.
+		//! \return The fingerprint, if the archive was built with one.
+		[[nodiscard]] std::optional<uint64_t> Fingerprint() const noexcept;
+
+		//! \brief             Checks that generated AssetId constants belong to
+		//!                    this archive.
+		//! \throw             std::runtime_error if the archive has no fingerprint
+		//!                    or it differs from \c fingerprint.
+		//! \param fingerprint The fingerprint the constants were generated with.
+		void RequireFingerprint(uint64_t fingerprint) const;
+
+		//! \brief  Obtains the optional features used by the archive.
+		//! \return A bitmask of features. \see EntryFormat.h
+		[[nodiscard]] uint32_t Features() const noexcept;
+
+		//! \brief       Obtains the offset of an entry from the start of the
+		//!              archive.
+		//! \pre         \c entry must have been obtained from this instance.
+		//! \param entry A valid entry.
+		//! \return      The offset of the entry.
+		[[nodiscard]] lam_size_t
+				OffsetOf(const MemMappedBucketEntry& entry) const noexcept;
+
 		//! \brief      Obtains the entry matching the specified name
 		//! \pre        the instance must have been constructed with a valid and
 		//!             compatible IDecompress, IHasher and IMemMapper.
@@ -108,6 +281,97 @@ namespace AssetMap {
 		//! \return     a MemMappedBucketEntry object.
 		MemMappedBucketEntry operator[](std::string_view name) const noexcept;
 
+		//! \brief      Obtains the entry matching the specified name using a hash
+		//!             computed in advance.
+		//!
+		//! Identical to operator[] except that \c name is not hashed. The hash
+		//! of a literal can be computed at compile time with StaticCityHash().
+		//! \pre        As for operator[]. \c hash must be the IHasher hash of
+		//!             \c name.
+		//! \post       As for operator[].
+		//! \param name The name of the item to retrieve
+		//! \param hash The hash of \c name.
+		//! \return     a MemMappedBucketEntry object.
+		[[nodiscard]] MemMappedBucketEntry
+				Find(std::string_view name, uint64_t hash) const noexcept;
+
+		//! \brief      Looks up an entry once so that it can be loaded repeatedly
+		//!             through operator[](AssetId) without searching for it.
+		//! \param name The name of the entry.
+		//! \return     A handle to the entry, if it exists.
+		[[nodiscard]] std::optional<AssetId>
+				Resolve(std::string_view name) const noexcept;
+
+		//! \brief      As for Resolve(std::string_view) with a precomputed hash.
+		//! \param name The name of the entry.
+		//! \param hash The IHasher hash of \c name.
+		//! \return     A handle to the entry, if it exists.
+		[[nodiscard]] std::optional<AssetId>
+				Resolve(std::string_view name, uint64_t hash) const noexcept;
+
+		//! \brief    Obtains an entry without hashing its name or searching for it.
+		//! \pre      \c id must have been generated for this archive. Call
+		//!           RequireFingerprint() once after opening to verify this.
+		//! \param id A generated asset ID.
+		//! \return   The entry.
+		MemMappedBucketEntry operator[](AssetId id) const noexcept;
+
+		//! \brief         Reads an entry as described by a BatchRequest.
+		//! \param request The entry to read and where to read it to.
+		//! \return        The entry's contents or the error that prevented reading
+		//!                it. Errors are reported here rather than thrown.
+		[[nodiscard]] BatchResult Retrieve(const BatchRequest& request) const;
+
+		//! \brief         Reads an entry into the destination described by a
+		//!                BatchRequest, whose \c id is ignored.
+		//! \param entry   The entry to read.
+		//! \param request Where to read it to.
+		//! \return        As for Retrieve(const BatchRequest&).
+		[[nodiscard]] static BatchResult Retrieve(MemMappedBucketEntry entry,
+																							const BatchRequest& request);
+
+		//! \brief          Reads many entries at once using a pool of threads.
+		//!
+		//! Entries are decompressed in order of their location within the archive
+		//! so that reads from the mapping are mostly sequential, one entry per
+		//! task. The call takes about as long as the largest entry rather than
+		//! the sum of all of them given enough workers.
+		//! \pre            The decompressor must support concurrent use, as ZSTD
+		//!                 does. Must not be called from a worker of \c pool.
+		//! \param requests The entries to read and where to read them to.
+		//! \param pool     The workers that decompress the entries.
+		//! \return         A result for each request, in the same order.
+		[[nodiscard]] std::vector<BatchResult>
+				RetrieveBatch(const std::vector<BatchRequest>& requests,
+											ThreadPool& pool) const;
+
+		//! \brief       Reads many entries by name using a pool of threads.
+		//!
+		//! As for RetrieveBatch(const std::vector<BatchRequest>&, ThreadPool&),
+		//! with every entry read into a newly allocated buffer. Names that do not
+		//! exist have their result's \c error set.
+		//! \param names The names of the entries to read.
+		//! \param pool  The workers that decompress the entries.
+		//! \return      A result for each name, in the same order.
+		[[nodiscard]] std::vector<BatchResult>
+				RetrieveBatch(const std::vector<std::string_view>& names,
+											ThreadPool& pool) const;
+
+		//! \brief     Asks for the data of entries to be read in ahead of time.
+		//!
+		//! Returns without waiting for the data, so that entries needed soon
+		//! (such as those of the next level) can be warmed up in the background
+		//! and later retrieved without stalling on page faults. Only the header
+		//! of each entry is read immediately. \see IMemMapper::WillNeed()
+		//! \param ids The entries that will be retrieved soon.
+		void Prefetch(const std::vector<AssetId>& ids) const;
+
+		//! \brief  Locks the parts of the archive used to look entries up into
+		//!         memory: the bucket table, lookup index, perfect hash and name
+		//!         table. Entries themselves are not locked.
+		//! \return Whether every part was locked. \see IMemMapper::Lock()
+		bool LockIndex() const noexcept;
+
 		//! \brief		 Obtains the bucket for the given index.
 		//! \pre			 \c idx must be in the range 0 <= \c idx < BucketCount(). If
 		//!            there are no buckets, the behaviour is undefined.
@@ -120,6 +384,27 @@ namespace AssetMap {
 		//!         buckets are present.
 		[[nodiscard]] Iterator begin() const noexcept;
 
+		//! \brief        Lists every entry whose name begins with \c prefix.
+		//!
+		//! With a Names section (BuildOptions::nameTable), this only reads that
+		//! section and takes logarithmic time to find the first match. Otherwise
+		//! every entry of the archive is visited.
+		//! \param prefix A prefix such as "textures/ui/". Empty lists everything.
+		//! \return       The name and ID of every match, sorted by name.
+		[[nodiscard]] std::vector<std::pair<std::string, AssetId>>
+				List(std::string_view prefix) const;
+
+		//! \brief         Lists every entry whose name matches a glob pattern.
+		//!
+		//! "?" matches any character other than "/", "*" any sequence of them and
+		//! "**" any sequence of characters at all. Every other character matches
+		//! itself. The part of \c pattern before the first wildcard is used as a
+		//! prefix as for List().
+		//! \param pattern A pattern such as "textures/*\/icon_?.png".
+		//! \return        The name and ID of every match, sorted by name.
+		[[nodiscard]] std::vector<std::pair<std::string, AssetId>>
+				Glob(std::string_view pattern) const;
+
 		//! \brief  Obtains an iterator to one-past-the-end as for C++ iterators.
 		//! \return The one-past-the-end iterator.
 		[[nodiscard]] Iterator end() const noexcept;
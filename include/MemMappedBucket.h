@@ -12,6 +12,10 @@ namespace AssetMap {
 		MemMappedBucketEntry next;
 		ICompress* comp			= nullptr;
 		IDecompress* decomp = nullptr;
+		IMemMapper* source	= nullptr;
+		uint32_t features		= 0;
+		const uint8_t* tags = nullptr;
+		lam_size_t count		= 0;
 
 		class Iterator {
 			MemMappedBucketEntry entry;
@@ -46,10 +50,16 @@ namespace AssetMap {
 		//! \param bucketsTbl A pointer to the start of the bucket offset table
 		//! \param id 				The valid index of the bucket in the buckets table.
 		//! \param decomp 		An IDecompress instance to use for decompression.
+		//! \param features 	The archive's features. \see EntryFormat.h
+		//! \param source 		If not nullptr, the IMemMapper holding the data, whose
+		//!										Read() is called before any part of the bucket is
+		//!										used. The bucket is empty if its tags cannot be read.
 		MemMappedBucket(uint8_t* begin,
 										uint8_t* bucketsTbl,
 										lam_size_t id,
-										IDecompress& decomp) noexcept;
+										IDecompress& decomp,
+										uint32_t features		= 0,
+										IMemMapper* source = nullptr) noexcept;
 
 		//! \brief            Initialises an empty bucket at the given location.
 		//! \post							The ICompress instance and data must live as long as
@@ -58,11 +68,13 @@ namespace AssetMap {
 		//! \param bucketsTbl A pointer to the start of the bucket offset table
 		//! \param id 				The valid index of the bucket in the buckets table.
 		//! \param decomp 		An ICompress instance to use for decompression.
+		//! \param features 	The archive's features. \see EntryFormat.h
 		MemMappedBucket(uint8_t* begin,
 										uint8_t* bucketsTbl,
 										ptrdiff_t offset,
 										lam_size_t bucketId,
-										ICompress& comp) noexcept;
+										ICompress& comp,
+										uint32_t features = 0) noexcept;
 
 		//! \brief  Returns an empty entry instance intended to be populated.
 		//! \return An entry object with zero size and no name.
@@ -77,6 +89,17 @@ namespace AssetMap {
 		//! \return     Either the found entry or one of the post-condition cases.
 		[[nodiscard]] MemMappedBucketEntry operator[](std::string_view name) const;
 
+		//! \brief      Finds an entry in this bucket with the given name.
+		//!
+		//! If the archive has featureBucketTags, only the entries whose tag
+		//! matches that of \c hash have their names compared.
+		//! \post       As for operator[].
+		//! \param name The name of the entry to return.
+		//! \param hash The IHasher hash of \c name.
+		//! \return     Either the found entry or one of the post-condition cases.
+		[[nodiscard]] MemMappedBucketEntry Find(std::string_view name,
+																						uint64_t hash) const noexcept;
+
 		//! \brief  Returns an iterator to the beginning of the bucket.
 		//! \return an iterator to the beginning or end() if empty.
 		[[nodiscard]] Iterator begin() const noexcept;
@@ -3,11 +3,15 @@
 
 #include "ICompress.h"
 #include "IDecompress.h"
+#include "IMemMapper.h"
 
 #include "MemOps.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <memory_resource>
 #include <string_view>
 #include <utility>
 
@@ -16,9 +20,27 @@ namespace AssetMap {
 		uint8_t* data				= nullptr;
 		ICompress* comp			= nullptr;
 		IDecompress* decomp = nullptr;
+		IMemMapper* source	= nullptr;
+		uint32_t features		= 0;
 
 		void Name(std::string_view name) noexcept;
 
+		[[nodiscard]] bool Load(const uint8_t* from, size_t len) const noexcept;
+
+		void LoadHeader() noexcept;
+
+		[[nodiscard]] bool LoadData() const noexcept;
+
+		[[nodiscard]] size_t NameOffset() const noexcept;
+
+		[[nodiscard]] size_t HeaderSize() const noexcept;
+
+		[[nodiscard]] lam_size_t StoredSize() const noexcept;
+
+		[[nodiscard]] const uint8_t* Target() const noexcept;
+
+		[[nodiscard]] MemMappedBucketEntry Resolve() const noexcept;
+
 		[[nodiscard]] uint8_t* FileData() noexcept;
 
 		[[nodiscard]] const uint8_t* FileData() const noexcept;
@@ -26,15 +48,27 @@ namespace AssetMap {
 		void FileSize(lam_size_t size);
 
 	public:
-		//! \brief      Constructor to reference available space for writing.
-		//! \param data A pointer to the location where entry data is to be written.
-		//! \param comp A valid instance of a compressor to compress the data.
-		MemMappedBucketEntry(uint8_t* data, ICompress& comp);
+		//! \brief          Constructor to reference available space for writing.
+		//! \param data     A pointer to the location where entry data is to be
+		//!                 written.
+		//! \param comp     A valid instance of a compressor to compress the data.
+		//! \param features The archive's features. \see EntryFormat.h
+		MemMappedBucketEntry(uint8_t* data,
+												 ICompress& comp,
+												 uint32_t features = 0);
 
-		//! \brief			  Constructor to reference an existing entry for reading.
-		//! \param data   A pointer to the location where an entry (may) exist.
-		//! \param decomp A valid instance of a decompressor to extract the data.
-		MemMappedBucketEntry(uint8_t* data, IDecompress& decomp);
+		//! \brief			    Constructor to reference an existing entry for reading.
+		//! \param data     A pointer to the location where an entry (may) exist.
+		//! \param decomp   A valid instance of a decompressor to extract the data.
+		//! \param features The archive's features. \see EntryFormat.h
+		//! \param source   If the archive is read on demand, the mapper \c data
+		//!                 points into. Every part of the entry is read through it
+		//!                 before being used. If its header cannot be read, the
+		//!                 instance points to no data.
+		MemMappedBucketEntry(uint8_t* data,
+												 IDecompress& decomp,
+												 uint32_t features		= 0,
+												 IMemMapper* source = nullptr);
 
 		//! \brief Constructs an instance not pointing to any data.
 		//! \post  Calling anything other than the comparison operators results in
@@ -43,6 +77,8 @@ namespace AssetMap {
 		explicit MemMappedBucketEntry(std::nullptr_t);
 
 		//! \brief Obtains the (compressed) size of this entry's file.
+		//!
+		//! For an alias, this is the size of the data it shares.
 		//! \return the size of this entry's file.
 		[[nodiscard]] lam_size_t FileSize() const noexcept;
 
@@ -55,7 +91,60 @@ namespace AssetMap {
 		//!         appropriate address to store the next entry.
 		[[nodiscard]] size_t InMemorySize() const noexcept;
 
+		//! \brief  Obtains the compressed data of this entry.
+		//!
+		//! Entries sharing their data (see entryAlias) return the same pointer,
+		//! which makes it suitable as a key for caching decompressed data.
+		//! \return A pointer to the compressed data and its size, or nullptr and
+		//!         0 if it could not be read.
+		[[nodiscard]] std::pair<const uint8_t*, size_t>
+				Compressed() const noexcept;
+
+		//! \brief  Obtains the contents of an entry stored without compression.
+		//!
+		//! The data points straight into the archive so reading it requires
+		//! neither an allocation nor a copy. It remains valid for as long as the
+		//! archive.
+		//! \return A pointer to the file's contents and their size, or nullptr
+		//!         and 0 if the entry is compressed or could not be read.
+		[[nodiscard]] std::pair<const uint8_t*, size_t> Stored() const noexcept;
+
+		//! \brief  Obtains the bytes needed to read this entry: the entry holding
+		//!         its data (the earlier entry for an alias) from its start to
+		//!         the end of its data.
+		//!
+		//! A copy of these bytes, such as one read from the archive's file, can
+		//! be read in place of the archive through Rebase().
+		//! \return A pointer to the bytes and their size, or nullptr and 0 if
+		//!         they could not be read.
+		[[nodiscard]] std::pair<const uint8_t*, size_t> Extent() const noexcept;
+
+		//! \brief      Obtains an entry that reads a copy of Extent() instead.
+		//!
+		//! The result never reads on demand.
+		//! \pre        \c copy must hold the bytes of Extent(), aligned to
+		//!             sizeof(lam_size_t), for as long as the result is used.
+		//! \param copy The copy.
+		//! \return     An entry reading from \c copy.
+		[[nodiscard]] MemMappedBucketEntry Rebase(uint8_t* copy) const noexcept;
+
+		//! \return Whether the entry's data was compressed in independent chunks,
+		//!         which makes reading part of it with Retrieve(size_t, uint8_t*,
+		//!         size_t) cheap. \see EntryFormat.h
+		[[nodiscard]] bool Chunked() const noexcept;
+
+		//! \brief  Obtains the location of this entry.
+		//! \return A pointer to the start of the entry or nullptr.
+		[[nodiscard]] const uint8_t* Address() const noexcept;
+
+		//! \brief  Obtains the flags of this entry.
+		//! \return The entry's flags, or 0 if the archive has no flags.
+		//! \see    EntryFormat.h
+		[[nodiscard]] uint8_t Flags() const noexcept;
+
 		//! \brief Obtains the name of this entry
+		//!
+		//! This is constant time if the archive has featureBucketTags.
 		//! \return the name of this entry.
 		[[nodiscard]] std::string_view Name() const noexcept;
 
@@ -71,6 +160,33 @@ namespace AssetMap {
 																	const uint8_t* ptr,
 																	size_t len) noexcept;
 
+		//! \brief      Initialises this entry with data that has already been
+		//!             compressed by a compatible ICompress instance.
+		//!
+		//! The result is identical to calling Populate() with the uncompressed
+		//! input and the same compressor settings. Alignment padding is zeroed.
+		//! \pre				\c name must not be empty.
+		//! \param name The name of the file
+		//! \param ptr  The compressed data to copy into the entry
+		//! \param len  The length of the compressed data (in bytes)
+		//! \param flags Flags to store if the archive has featureEntryFlags.
+		//! \return     The total in-memory size of this entire entry.
+		//! \see				InMemorySize()
+		[[nodiscard]] size_t Emplace(std::string_view name,
+																 const uint8_t* ptr,
+																 size_t len,
+																 uint8_t flags = 0) noexcept;
+
+		//! \brief          Initialises this entry as an alias of an earlier entry.
+		//! \pre            The archive must have featureEntryFlags and the earlier
+		//!                 entry must not be an alias itself.
+		//! \param name     The name of the file
+		//! \param distance The number of bytes from the start of the earlier
+		//!                 entry to the start of this one.
+		//! \return         The total in-memory size of this entire entry.
+		[[nodiscard]] size_t EmplaceAlias(std::string_view name,
+																			lam_size_t distance) noexcept;
+
 		//! \brief  Initializes this entry to a size of zero and an empty name
 		//! \return The total in-memory size of this entire entry.
 		[[nodiscard]] size_t MakeNull() noexcept;
@@ -79,10 +195,65 @@ namespace AssetMap {
 		//! \return a pair containing the data and its size.
 		[[nodiscard]] std::pair<std::unique_ptr<uint8_t[]>, size_t> Retrieve();
 
-		//! \brief Decompresses the data into \c buf up to a limit of \c len
+		//! \brief Decompresses (or copies, if stored) the data into \c buf up to
+		//!        a limit of \c len
 		//! \return the number of bytes written to \c buf
 		[[nodiscard]] size_t Retrieve(uint8_t* buf, size_t len);
 
+		//! \brief      Decompresses (or copies, if stored) the data a block at a
+		//!             time without ever holding the whole file in memory.
+		//!
+		//! Stopping early by returning false from \c sink avoids decompressing
+		//! the rest of the file, such as when only its header is of interest.
+		//! \param sink Receives each block of the file in order.
+		//! \return     The number of bytes passed to \c sink.
+		//! \throws     std::runtime_error if the data could not be read or
+		//!             decompressed.
+		size_t Stream(const IDecompress::Sink& sink);
+
+		//! \brief        Reads part of the file.
+		//!
+		//! Only the chunks covering the range are decompressed if the entry is
+		//! Chunked(). Otherwise a compressed entry is decompressed in full into a
+		//! temporary buffer unless the range covers the whole file.
+		//! \param offset The offset within the decompressed file to start at.
+		//! \param buf    Where to write the data.
+		//! \param len    The number of bytes to read.
+		//! \return       The number of bytes written to \c buf. Fewer than \c len
+		//!               if the file ends first or cannot be decompressed.
+		[[nodiscard]] size_t Retrieve(size_t offset, uint8_t* buf, size_t len);
+
+		//! \brief          Decompresses (or copies, if stored) the data into memory
+		//!                 obtained from \c allocate.
+		//!
+		//! The entry and its frame header are only read once, unlike calling
+		//! DecompressedSize() followed by Retrieve(uint8_t*, size_t).
+		//! \param allocate Called once with the decompressed size. Must return a
+		//!                 buffer of at least that size or throw.
+		//! \return         The buffer and the number of bytes written to it, which
+		//!                 is the decompressed size unless decompression failed.
+		//! \throws         std::runtime_error if the data could not be read.
+		[[nodiscard]] std::pair<uint8_t*, size_t>
+				Retrieve(const std::function<uint8_t*(size_t)>& allocate);
+
+		//! \brief          Decompresses (or copies, if stored) the data into memory
+		//!                 allocated from \c resource.
+		//!
+		//! Allocating from an arena (std::pmr::monotonic_buffer_resource) or a
+		//! pool (std::pmr::unsynchronized_pool_resource) avoids the general
+		//! purpose allocator entirely and lets many entries be freed at once.
+		//! \post           Unless the resource frees it by itself, the buffer must
+		//!                 be released with resource.deallocate(buffer, size,
+		//!                 alignof(std::max_align_t)), where size is the one
+		//!                 returned.
+		//! \param resource The memory resource to allocate from.
+		//! \return         The buffer and its size. The buffer is null if the
+		//!                 size is 0.
+		//! \throws         std::runtime_error if the data could not be
+		//!                 decompressed, in which case nothing remains allocated.
+		[[nodiscard]] std::pair<uint8_t*, size_t>
+				Retrieve(std::pmr::memory_resource& resource);
+
 		//! \brief  Increments this entry to point to the next entry space.
 		//! \pre    This instance must currently have a valid name and size.
 		//! \return a reference to *this.
@@ -35,7 +35,7 @@ namespace AssetMap {
 		static_assert(std::is_integral_v<T>, "Only integral values permitted");
 		T ret = 0;
 		for (auto i = 0; i < sizeof(T); ++i)
-			ret |= buf[i] << (8 * i);
+			ret |= static_cast<T>(buf[i]) << (8 * i);
 		return ret;
 	}
 
@@ -0,0 +1,130 @@
+#ifndef LIBASSETMAP_NAMETABLE_H
+#define LIBASSETMAP_NAMETABLE_H
+
+#include "MemOps.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// clang-format off
+//! \file NameTable.h
+//! \brief The sorted, front-coded names of every entry of an archive.
+/*! \verbatim
+Stored as the Names section (see ArchiveSections.h):
+
++--------------------+---------------------------------+
+| [count] lam_size_t | [blocks] lam_size_t * ...       |
++--------------------+---------------------------------+
+| [entries] lam_size_t * count ...                     |
++------------------------------------------------------+
+| [names] ...                                          |
++------------------------------------------------------+
+
+Names are sorted bytewise and split into blocks of 16. blocks holds the
+offset of each block from the start of names and entries holds the offset of
+the entry each name belongs to from the start of the archive, in name order.
+
+Each name is stored as two LEB128 integers, the length of the prefix it shares
+with the previous name and the length of the remainder, followed by the
+remainder. The first name of every block shares nothing, so a block can be
+decoded without any of the blocks before it.
+\endverbatim
+*/
+// clang-format on
+
+namespace AssetMap {
+	//! \brief Reads and writes the Names section of an archive.
+	//!
+	//! Names are identified by their ordinal, their position in sorted order.
+	class NameTable {
+		const uint8_t* blocks	 = nullptr;
+		const uint8_t* entries = nullptr;
+		const uint8_t* names	 = nullptr;
+		lam_size_t count			 = 0;
+
+		template <class Visitor>
+		void Scan(lam_size_t block, std::string_view name, Visitor&& visit) const
+				noexcept;
+
+	public:
+		//! \brief The number of names in each front-coded block.
+		static constexpr lam_size_t blockSize = 16;
+
+		//! \brief Constructs an empty table.
+		NameTable() noexcept = default;
+
+		//! \brief      Constructs a table over a Names section.
+		//! \param data A pointer to the section or nullptr if it is absent.
+		//! \param len  The size of the section.
+		NameTable(const uint8_t* data, size_t len) noexcept;
+
+		//! \return The number of names in the table.
+		[[nodiscard]] lam_size_t Size() const noexcept;
+
+		//! \brief         Decodes a name.
+		//! \pre           \c ordinal < Size()
+		//! \param ordinal The ordinal of the name.
+		//! \return        The name.
+		[[nodiscard]] std::string Name(lam_size_t ordinal) const;
+
+		//! \brief         Compares a name to \c name without decoding it.
+		//! \pre           \c ordinal < Size()
+		//! \param ordinal The ordinal of the name.
+		//! \param name    The name to compare to.
+		//! \return        Whether they are equal.
+		[[nodiscard]] bool Equals(lam_size_t ordinal,
+															std::string_view name) const noexcept;
+
+		//! \brief         Obtains the entry a name belongs to.
+		//! \pre           \c ordinal < Size()
+		//! \param ordinal The ordinal of the name.
+		//! \return        The offset of the entry from the start of the archive.
+		[[nodiscard]] lam_size_t Entry(lam_size_t ordinal) const noexcept;
+
+		//! \brief      Finds the first name that does not sort before \c name.
+		//! \param name Any string.
+		//! \return     An ordinal, or Size() if every name sorts before \c name.
+		[[nodiscard]] lam_size_t LowerBound(std::string_view name) const noexcept;
+
+		//! \brief        Finds every name beginning with \c prefix.
+		//! \param prefix Any string.
+		//! \return       The ordinals of the first matching name and one past the
+		//!               last. Both are equal if nothing matches.
+		[[nodiscard]] std::pair<lam_size_t, lam_size_t>
+				PrefixRange(std::string_view prefix) const noexcept;
+
+		//! \brief       Decodes a range of names in order.
+		//! \pre         \c first <= \c last <= Size()
+		//! \param first The ordinal of the first name.
+		//! \param last  One past the ordinal of the last name.
+		//! \param visit Called with the ordinal and name of each. The name is
+		//!              only valid for the duration of the call.
+		void Visit(lam_size_t first,
+							 lam_size_t last,
+							 const std::function<void(lam_size_t, std::string_view)>& visit)
+				const;
+
+		//! \brief      Finds a name.
+		//! \param name The name to find.
+		//! \return     Its ordinal, if it is in the table.
+		[[nodiscard]] std::optional<lam_size_t>
+				Find(std::string_view name) const noexcept;
+
+		//! \return Whether this instance refers to a table.
+		explicit operator bool() const noexcept;
+
+		//! \brief       Encodes a Names section.
+		//! \pre         \c names must be sorted and unique.
+		//! \param names Every name and the offset of the entry it belongs to.
+		//! \return      The contents of the section.
+		[[nodiscard]] static std::vector<uint8_t>
+				Encode(const std::vector<std::pair<std::string, lam_size_t>>& names);
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_NAMETABLE_H
@@ -0,0 +1,72 @@
+#ifndef LIBASSETMAP_PERFECTHASH_H
+#define LIBASSETMAP_PERFECTHASH_H
+
+#include "MemOps.h"
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// clang-format off
+//! \file PerfectHash.h
+//! \brief A minimal perfect hash index over the entries of an archive.
+/*! \verbatim
+Stored as the PerfectHash section (see ArchiveSections.h). The index is built
+with the CHD (compress, hash, displace) algorithm over the IHasher hash of
+every entry name and maps each of them to a distinct slot:
+
++---------------------+----------------------+--------------------------+
+| [slots] lam_size_t  | [groups] lam_size_t  | [seeds] lam_size_t * ... |
++---------------------+----------------------+--------------------------+
+| [entries] lam_size_t * slots ...                                      |
++-----------------------------------------------------------------------+
+
+A hash belongs to the group Mix(hash) % groups, where Mix is the SplitMix64
+finaliser. Its slot is Mix(hash + (seed + 1) * 0x9E3779B97F4A7C15) % slots
+using the seed of its group. Each slot
+holds the offset of an entry from the start of the archive. There are exactly
+as many slots as entries, so a lookup is one hash, two table reads and a
+comparison of the name to confirm that it is actually in the archive.
+\endverbatim
+*/
+// clang-format on
+
+namespace AssetMap {
+	//! \brief Reads and writes the PerfectHash section of an archive.
+	class PerfectHashIndex {
+		const uint8_t* seeds	 = nullptr;
+		const uint8_t* entries = nullptr;
+		lam_size_t slots			 = 0;
+		lam_size_t groups			 = 0;
+
+	public:
+		//! \brief Constructs an empty index.
+		PerfectHashIndex() noexcept = default;
+
+		//! \brief      Constructs an index over a PerfectHash section.
+		//! \param data A pointer to the section or nullptr if it is absent.
+		//! \param len  The size of the section.
+		PerfectHashIndex(const uint8_t* data, size_t len) noexcept;
+
+		//! \brief      Finds the only entry that can have the given hash.
+		//! \pre        The index must not be empty.
+		//! \param hash The IHasher hash of an entry name.
+		//! \return     The offset of an entry from the start of the archive. If
+		//!             the name was not in the archive, this is an unrelated
+		//!             entry whose name must be checked by the caller.
+		[[nodiscard]] lam_size_t Find(uint64_t hash) const noexcept;
+
+		//! \return Whether this instance refers to a non-empty index.
+		explicit operator bool() const noexcept;
+
+		//! \brief      Encodes a PerfectHash section.
+		//! \throw      std::runtime_error if two entries have the same hash.
+		//! \param keys The hash of every entry name and the entry's offset.
+		//! \return     The contents of the section.
+		[[nodiscard]] static std::vector<uint8_t>
+				Encode(const std::vector<std::pair<uint64_t, lam_size_t>>& keys);
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_PERFECTHASH_H
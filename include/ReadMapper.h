@@ -0,0 +1,85 @@
+#ifndef LIBASSETMAP_READMAPPER_H
+#define LIBASSETMAP_READMAPPER_H
+
+#include "IMemMapper.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace AssetMap {
+	//! \brief An IMemMapper that reads a file on demand rather than mapping it.
+	//!
+	//! Suits filesystems on which page faults of a mapping are slow or
+	//! serialised, such as FUSE or network filesystems, and platforms that
+	//! cannot map files at all. Nothing is read when the file is opened.
+	//! MemMappedArchive reads the bucket table and the sections at the end of
+	//! the archive when it is constructed, and every other part of the file
+	//! the first time an entry in it is used, through Read(). Reads cover whole
+	//! blocks and adjacent missing blocks are read together.
+	//!
+	//! Blocks are read into a buffer the size of the file, at their offset in
+	//! it, so that entries can point into it as they would into a mapping. A
+	//! block stays in memory until the instance is destroyed; only the blocks
+	//! read take up memory on systems which commit memory lazily.
+	//! Pass it to MemMappedArchive in place of a MemMapper.
+	class ReadMapper : public IMemMapper {
+		struct Blocks;
+
+		std::unique_ptr<uint8_t[]> data;
+		size_t len = 0;
+		std::unique_ptr<Blocks> blocks;
+
+	public:
+		//! The default number of bytes in a block.
+		static constexpr size_t defaultBlockSize = 256 << 10;
+
+		//! \brief           Opens an existing file without reading any of it.
+		//! \param file      A valid, regular file.
+		//! \param blockSize The smallest number of bytes read at once.
+		//! \throws          std::runtime_error if the file could not be opened.
+		explicit ReadMapper(const std::filesystem::directory_entry& file,
+												size_t blockSize = defaultBlockSize);
+
+		ReadMapper(const ReadMapper&) = delete;
+
+		ReadMapper(ReadMapper&&) noexcept;
+
+		ReadMapper& operator=(ReadMapper&&) noexcept;
+
+		//! \brief  The file is only ever read.
+		//! \throws std::runtime_error always.
+		IMemMapper& Resize(size_t size) override;
+
+		//! \return The size of the file in bytes.
+		[[nodiscard]] size_t Size() const noexcept override;
+
+		//! \return The buffer the file is read into. Only the ranges passed to
+		//!         Read() hold the file's contents. nullptr if the file is empty.
+		[[nodiscard]] const uint8_t* Get() const noexcept override;
+
+		//! \return The buffer the file is read into. Only the ranges passed to
+		//!         Read() hold the file's contents. nullptr if the file is empty.
+		[[nodiscard]] uint8_t* Get() noexcept override;
+
+		//! \return true
+		[[nodiscard]] bool OnDemand() const noexcept override;
+
+		//! \brief        Reads every block overlapping a range that has not been
+		//!               read yet.
+		//!
+		//! Thread-safe. Blocks are read one call at a time.
+		//! \param offset The offset of the first byte needed.
+		//! \param len    The number of bytes needed.
+		//! \return       Whether the range has been read. If not, a later call
+		//!               tries again.
+		bool Read(size_t offset, size_t len) noexcept override;
+
+		//! \return The number of bytes read from the file so far.
+		[[nodiscard]] size_t BytesRead() const noexcept;
+
+		~ReadMapper() noexcept override;
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_READMAPPER_H
@@ -0,0 +1,199 @@
+#ifndef LIBASSETMAP_STATICCITYHASH_H
+#define LIBASSETMAP_STATICCITYHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//! \file StaticCityHash.h
+//! \brief A constexpr implementation of CityHash64 (v1.1).
+//!
+//! The result is identical to CityHash::Hash() for the same input, which allows
+//! the hash of a name known at compile time to be passed to
+//! MemMappedArchive::Find() without hashing it at runtime.
+
+namespace AssetMap {
+	namespace StaticCityHashDetail {
+		constexpr uint64_t k0 = 0xc3a5c85c97cb3127ULL;
+		constexpr uint64_t k1 = 0xb492b66fbe98f273ULL;
+		constexpr uint64_t k2 = 0x9ae16a3b2f90404fULL;
+
+		struct Pair {
+			uint64_t first;
+			uint64_t second;
+		};
+
+		constexpr uint64_t Fetch(std::string_view s, size_t pos, size_t len) {
+			uint64_t ret = 0;
+			for (size_t i = 0; i < len; ++i)
+				ret |= static_cast<uint64_t>(static_cast<uint8_t>(s[pos + i]))
+							 << (8 * i);
+			return ret;
+		}
+
+		constexpr uint64_t Fetch64(std::string_view s, size_t pos) {
+			return Fetch(s, pos, sizeof(uint64_t));
+		}
+
+		constexpr uint64_t Fetch32(std::string_view s, size_t pos) {
+			return Fetch(s, pos, sizeof(uint32_t));
+		}
+
+		constexpr uint64_t Rotate(uint64_t val, int shift) {
+			return shift == 0 ? val : ((val >> shift) | (val << (64 - shift)));
+		}
+
+		constexpr uint64_t ShiftMix(uint64_t val) {
+			return val ^ (val >> 47);
+		}
+
+		constexpr uint64_t Bswap64(uint64_t val) {
+			uint64_t ret = 0;
+			for (int i = 0; i < 8; ++i)
+				ret = (ret << 8) | ((val >> (8 * i)) & 0xff);
+			return ret;
+		}
+
+		constexpr uint64_t HashLen16(uint64_t u, uint64_t v, uint64_t mul) {
+			uint64_t a = (u ^ v) * mul;
+			a ^= (a >> 47);
+			uint64_t b = (v ^ a) * mul;
+			b ^= (b >> 47);
+			b *= mul;
+			return b;
+		}
+
+		constexpr uint64_t HashLen16(uint64_t u, uint64_t v) {
+			return HashLen16(u, v, 0x9ddfea08eb382d69ULL);
+		}
+
+		constexpr uint64_t HashLen0to16(std::string_view s) {
+			auto len = s.size();
+			if (len >= 8) {
+				uint64_t mul = k2 + len * 2;
+				uint64_t a	 = Fetch64(s, 0) + k2;
+				uint64_t b	 = Fetch64(s, len - 8);
+				uint64_t c	 = Rotate(b, 37) * mul + a;
+				uint64_t d	 = (Rotate(a, 25) + b) * mul;
+				return HashLen16(c, d, mul);
+			}
+			if (len >= 4) {
+				uint64_t mul = k2 + len * 2;
+				uint64_t a	 = Fetch32(s, 0);
+				return HashLen16(len + (a << 3), Fetch32(s, len - 4), mul);
+			}
+			if (len > 0) {
+				uint8_t a	 = static_cast<uint8_t>(s[0]);
+				uint8_t b	 = static_cast<uint8_t>(s[len >> 1]);
+				uint8_t c	 = static_cast<uint8_t>(s[len - 1]);
+				uint32_t y = static_cast<uint32_t>(a) + (static_cast<uint32_t>(b) << 8);
+				uint32_t z = static_cast<uint32_t>(len) + (static_cast<uint32_t>(c) << 2);
+				return ShiftMix(y * k2 ^ z * k0) * k2;
+			}
+			return k2;
+		}
+
+		constexpr uint64_t HashLen17to32(std::string_view s) {
+			auto len		 = s.size();
+			uint64_t mul = k2 + len * 2;
+			uint64_t a	 = Fetch64(s, 0) * k1;
+			uint64_t b	 = Fetch64(s, 8);
+			uint64_t c	 = Fetch64(s, len - 8) * mul;
+			uint64_t d	 = Fetch64(s, len - 16) * k2;
+			return HashLen16(Rotate(a + b, 43) + Rotate(c, 30) + d,
+											 a + Rotate(b + k2, 18) + c,
+											 mul);
+		}
+
+		constexpr Pair WeakHashLen32WithSeeds(std::string_view s,
+																					size_t pos,
+																					uint64_t a,
+																					uint64_t b) {
+			uint64_t w = Fetch64(s, pos);
+			uint64_t x = Fetch64(s, pos + 8);
+			uint64_t y = Fetch64(s, pos + 16);
+			uint64_t z = Fetch64(s, pos + 24);
+			a += w;
+			b					 = Rotate(b + a + z, 21);
+			uint64_t c = a;
+			a += x;
+			a += y;
+			b += Rotate(a, 44);
+			return {a + z, b + c};
+		}
+
+		constexpr uint64_t HashLen33to64(std::string_view s) {
+			auto len		 = s.size();
+			uint64_t mul = k2 + len * 2;
+			uint64_t a	 = Fetch64(s, 0) * k2;
+			uint64_t b	 = Fetch64(s, 8);
+			uint64_t c	 = Fetch64(s, len - 24);
+			uint64_t d	 = Fetch64(s, len - 32);
+			uint64_t e	 = Fetch64(s, 16) * k2;
+			uint64_t f	 = Fetch64(s, 24) * 9;
+			uint64_t g	 = Fetch64(s, len - 8);
+			uint64_t h	 = Fetch64(s, len - 16) * mul;
+			uint64_t u	 = Rotate(a + g, 43) + (Rotate(b, 30) + c) * 9;
+			uint64_t v	 = ((a + g) ^ d) + f + 1;
+			uint64_t w	 = Bswap64((u + v) * mul) + h;
+			uint64_t x	 = Rotate(e + f, 42) + c;
+			uint64_t y	 = (Bswap64((v + w) * mul) + g) * mul;
+			uint64_t z	 = e + f + c;
+			a						 = Bswap64((x + z) * mul + y) + b;
+			b						 = ShiftMix((z + a) * mul + d + h) * mul;
+			return b + x;
+		}
+	} // namespace StaticCityHashDetail
+
+	//! \brief      Computes CityHash64 of \c s, at compile time if possible.
+	//! \param s    A sequence of bytes to hash.
+	//! \return     The same value as CityHash::Hash(s).
+	constexpr uint64_t StaticCityHash(std::string_view s) {
+		using namespace StaticCityHashDetail;
+		auto len = s.size();
+		if (len <= 16)
+			return HashLen0to16(s);
+		if (len <= 32)
+			return HashLen17to32(s);
+		if (len <= 64)
+			return HashLen33to64(s);
+
+		uint64_t x = Fetch64(s, len - 40);
+		uint64_t y = Fetch64(s, len - 16) + Fetch64(s, len - 56);
+		uint64_t z = HashLen16(Fetch64(s, len - 48) + len, Fetch64(s, len - 24));
+		Pair v		 = WeakHashLen32WithSeeds(s, len - 64, len, z);
+		Pair w		 = WeakHashLen32WithSeeds(s, len - 32, y + k1, x);
+		x					 = x * k1 + Fetch64(s, 0);
+
+		size_t pos = 0;
+		len				 = (len - 1) & ~static_cast<size_t>(63);
+		do {
+			x = Rotate(x + y + v.first + Fetch64(s, pos + 8), 37) * k1;
+			y = Rotate(y + v.second + Fetch64(s, pos + 48), 42) * k1;
+			x ^= w.second;
+			y += v.first + Fetch64(s, pos + 40);
+			z = Rotate(z + w.first, 33) * k1;
+			v = WeakHashLen32WithSeeds(s, pos, v.second * k1, x + w.first);
+			w = WeakHashLen32WithSeeds(
+					s, pos + 32, z + w.second, y + Fetch64(s, pos + 16));
+			auto tmp = z;
+			z				 = x;
+			x				 = tmp;
+			pos += 64;
+			len -= 64;
+		} while (len != 0);
+		return HashLen16(HashLen16(v.first, w.first) + ShiftMix(y) * k1 + z,
+										 HashLen16(v.second, w.second) + x);
+	}
+
+	namespace Literals {
+		//! \brief Computes CityHash64 of a string literal at compile time.
+		//!
+		//! e.g. archive.Find("path/to/file", "path/to/file"_cityhash)
+		constexpr uint64_t operator""_cityhash(const char* s, size_t len) {
+			return StaticCityHash({s, len});
+		}
+	} // namespace Literals
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_STATICCITYHASH_H
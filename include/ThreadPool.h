@@ -0,0 +1,55 @@
+#ifndef LIBASSETMAP_THREADPOOL_H
+#define LIBASSETMAP_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AssetMap {
+	//! \brief A fixed-size pool of worker threads executing queued tasks in
+	//!        FIFO order.
+	//!
+	//! Every task is handed the index of the worker executing it. This allows
+	//! callers to keep per-worker state (such as a compression context) in a
+	//! plain vector indexed by worker without any further synchronisation.
+	class ThreadPool {
+		std::vector<std::thread> threads;
+		std::deque<std::function<void(unsigned)>> tasks;
+		std::mutex mtx;
+		std::condition_variable cv;
+		bool stopping = false;
+
+		void Run(unsigned worker) noexcept;
+
+	public:
+		//! \brief         Starts the pool.
+		//! \param threads The number of workers to start. 0 selects
+		//!                \c DefaultThreads()
+		explicit ThreadPool(unsigned threads);
+
+		ThreadPool(const ThreadPool&) = delete;
+
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		//! \brief      Queues a task for execution by the next free worker.
+		//! \pre        \c task must not throw. Capture any exception yourself if
+		//!             you need to report it.
+		//! \param task A callable receiving the index of the worker running it, in
+		//!             the range 0 <= index < Size().
+		void Submit(std::function<void(unsigned)> task);
+
+		//! \return The number of workers in this pool.
+		[[nodiscard]] unsigned Size() const noexcept;
+
+		//! \return The number of hardware threads or 1 if it cannot be determined.
+		[[nodiscard]] static unsigned DefaultThreads() noexcept;
+
+		//! \brief Runs every queued task to completion and joins all workers.
+		~ThreadPool() noexcept;
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_THREADPOOL_H
@@ -4,6 +4,7 @@
 #include "ICompress.h"
 #include "IDecompress.h"
 
+#include <mutex>
 #include <vector>
 
 using ZSTD_CCtx	 = struct ZSTD_CCtx_s;
@@ -33,7 +34,10 @@ namespace AssetMap {
 
 	class ZSTD : public ICompress, public IDecompress {
 		ZCtx<ZSTD_CCtx> cCtx;
-		ZCtx<ZSTD_DCtx> dCtx;
+		ZCtx<ZSTD_DDict> dDict;
+		std::vector<ZCtx<ZSTD_DCtx>> dCtxs;
+		std::mutex dCtxMtx;
+		bool decompressing				= false;
 		const uint8_t* dictionary = nullptr;
 		size_t dictLen						= 0;
 		int compressionLevel			= 0;
@@ -46,6 +50,10 @@ namespace AssetMap {
 
 		ZSTD(float dictRatio) noexcept;
 
+		ZCtx<ZSTD_DCtx> AcquireDCtx();
+
+		void ReleaseDCtx(ZCtx<ZSTD_DCtx> ctx) noexcept;
+
 	public:
 		static constexpr compress_t compress{};
 		static constexpr decompress_t decompress{};
@@ -90,6 +98,10 @@ namespace AssetMap {
 																	size_t dstLen) override;
 
 		//! \brief        Decompresses data from src into dst.
+		//!
+		//! May be called concurrently from any number of threads. Each call
+		//! borrows a decompression context from a pool that grows to the number
+		//! of concurrent callers; all of them share the digested dictionary.
 		//! \pre					If the data was compressed with a dictionary, it must have
 		//!               been loaded.
 		//! \param src    The source buffer to decompress data from.
@@ -103,6 +115,19 @@ namespace AssetMap {
 																		uint8_t* dst,
 																		size_t dstLen) override;
 
+		//! \brief        Decompresses data from src a block at a time.
+		//!
+		//! Blocks are at most ZSTD_DStreamOutSize() (128KiB) in size. As with
+		//! Decompress(), this may be called concurrently from any number of
+		//! threads.
+		//! \param src    The source buffer to decompress data from.
+		//! \param srcLen The length in bytes to decompress.
+		//! \param sink   Receives every block of decompressed data.
+		//! \return       The number of bytes passed to \c sink.
+		size_t DecompressStream(const uint8_t* src,
+														size_t srcLen,
+														const Sink& sink) override;
+
 		//! \brief     Calculates the worst-case size needed to compress the data.
 		//! \param len The size of the input data
 		//! \return 	 The worst-case space requirement to compress the data.
@@ -129,11 +154,18 @@ namespace AssetMap {
 				CreateDictionary(std::filesystem::directory_entry samplesDir) override;
 
 		//! \brief      References a dictionary for (de)compression purposes.
+		//!
+		//! For decompression, the dictionary is digested once and shared by every
+		//! decompression context.
+		//! \pre        No call to Decompress() may be in progress.
 		//! \post       The dictionary must remain valid for the lifetime of this
 		//!             instance.
+		//! \throw      std::runtime_error if the dictionary cannot be digested for
+		//!             decompression, e.g. because it is corrupt. The previous
+		//!             dictionary, if any, remains in use.
 		//! \param dict A buffer containing the dictionary to load.
 		//! \param len  The size of the dictionary (in bytes)
-		void UseDictionary(const uint8_t* dict, size_t len) noexcept override;
+		void UseDictionary(const uint8_t* dict, size_t len) override;
 
 		//! \brief		 Reads a file into memory and uses it as a dictionary.
 		//!
@@ -155,6 +187,17 @@ namespace AssetMap {
 		//! 						 \c MinStrategyLevel() \<= level \<= MaxStrategyLevel()
 		void SetStrategyLevel(int level) noexcept;
 
+		//! \return The zstd version, compression level and strategy.
+		[[nodiscard]] std::string Settings() const override;
+
+		//! \brief  Creates a compressor with this instance's compression level,
+		//!         strategy and dictionary.
+		//! \pre    This instance must have been constructed for compression.
+		//! \post   The dictionary is referenced, not copied. This instance must
+		//!         outlive the clone.
+		//! \return A new, independent compressor.
+		[[nodiscard]] std::unique_ptr<ICompress> Clone() const override;
+
 		//! \return The minimum compression level. Usually a large negative value.
 		static int MinCompressLevel() noexcept;
 
@@ -0,0 +1,72 @@
+#ifndef LIBASSETMAP_BATCHREADER_H
+#define LIBASSETMAP_BATCHREADER_H
+
+#include "MemMappedArchive.h"
+#include "MemMapper.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace AssetMap {
+	class ThreadPool;
+
+	//! \brief Reads batches of entries from an archive's file with explicit
+	//!        reads rather than through its mapping.
+	//!
+	//! Reading a cold mapping faults its pages in one at a time. This instead
+	//! issues the reads of every entry in a batch at once, with io_uring on
+	//! Linux where it is available and pread() otherwise, and decompresses each
+	//! entry on a ThreadPool as soon as its read completes, so that reading
+	//! and decompressing overlap. Only the entries' data is read; the archive's
+	//! index is still used through its mapping.
+	class BatchReader {
+		struct Ring;
+
+		const MemMappedArchive& archive;
+		FileDescriptor fd;
+		std::unique_ptr<Ring> ring;
+
+	public:
+		//! The default number of reads in flight at once.
+		static constexpr unsigned defaultDepth = 64;
+
+		//! \brief         Opens an archive's file for reading.
+		//! \param archive The archive, which must outlive this instance.
+		//! \param file    The file \c archive was opened from.
+		//! \param depth   The maximum number of reads in flight at once.
+		//! \param uring   Whether to try io_uring. If false, or if io_uring is
+		//!                unavailable, entries are read with pread().
+		//! \throws        std::runtime_error if the file could not be opened.
+		BatchReader(const MemMappedArchive& archive,
+								const std::filesystem::directory_entry& file,
+								unsigned depth = defaultDepth,
+								bool uring		 = true);
+
+		BatchReader(const BatchReader&) = delete;
+
+		//! \return Whether reads are issued through io_uring.
+		[[nodiscard]] bool Uring() const noexcept;
+
+		//! \brief          Reads many entries at once, as
+		//!                 MemMappedArchive::RetrieveBatch() does.
+		//!
+		//! Blocks until every entry has been read and decompressed. Should
+		//! io_uring fail part way through, the reads it had not finished are
+		//! retried with pread() before any is reported as failed.
+		//! \pre            Not called concurrently on the same instance, nor from
+		//!                 one of \c pool's workers: the call waits for tasks it
+		//!                 queues on \c pool, so it would deadlock if it occupied
+		//!                 the worker they need.
+		//! \param requests The entries to read and where to read them to.
+		//! \param pool     The threads to decompress on.
+		//! \return         A result for each request, in the same order. Errors
+		//!                 are reported in the results rather than thrown.
+		[[nodiscard]] std::vector<BatchResult>
+				Read(const std::vector<BatchRequest>& requests, ThreadPool& pool);
+
+		~BatchReader() noexcept;
+	};
+} // namespace AssetMap
+
+#endif // LIBASSETMAP_BATCHREADER_H
@@ -26,9 +26,12 @@ namespace AssetMap {
 		FileDescriptor fd;
 		uintmax_t len;
 		void* mMap = nullptr;
+		MapStats stats;
 
 		void Close() noexcept;
 
+		void Populate() noexcept;
+
 	public:
 		//! \brief      Constructs a MemMapper from a file path.
 		//! \pre				If creating a file, the directory hierarchy must exist, it
@@ -40,6 +43,19 @@ namespace AssetMap {
 		//! \param file A valid path to an existing file, or location to create one.
 		explicit MemMapper(const std::filesystem::directory_entry& file);
 
+		//! \brief         Opens and maps an existing file for reading.
+		//!
+		//! Options that cannot be honoured, such as locking more memory than the
+		//! process is allowed to, are skipped rather than treated as errors.
+		//! Check Stats() to see which took effect.
+		//! \param file    A valid path to an existing, non-empty file.
+		//! \param options How to map the file.
+		//! \throws        std::runtime_error if the file does not exist, is empty
+		//!                or could not be mapped. A missing file is never
+		//!                created.
+		MemMapper(const std::filesystem::directory_entry& file,
+							const MapOptions& options);
+
 		MemMapper(const MemMapper&) = delete;
 
 		MemMapper(MemMapper&& rhs) noexcept;
@@ -72,6 +88,25 @@ namespace AssetMap {
 		//! \return the beginning of the memory-mapped data.
 		[[nodiscard]] uint8_t* Get() noexcept override;
 
+		//! \brief        Locks a range with mlock().
+		//! \param offset The offset of the first byte to lock.
+		//! \param len    The number of bytes to lock.
+		//! \return       Whether the range is now locked.
+		bool Lock(size_t offset, size_t len) noexcept override;
+
+		//! \return What happened when the file was opened.
+		[[nodiscard]] const MapStats& Stats() const noexcept;
+
+		//! \brief        Passes the access pattern on with madvise().
+		//! \param access The expected access pattern.
+		void Advise(Access access) noexcept override;
+
+		//! \brief        Asks the kernel to read the pages of a range in ahead of
+		//!               time with madvise(MADV_WILLNEED).
+		//! \param offset The offset of the first byte that will be needed.
+		//! \param len    The number of bytes that will be needed.
+		void WillNeed(size_t offset, size_t len) noexcept override;
+
 		~MemMapper() noexcept override;
 	};
 } // namespace AssetMap
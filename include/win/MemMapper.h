@@ -26,11 +26,16 @@ namespace AssetMap {
 		uintmax_t len;
 		void* fMap = nullptr;
 		void* mMap = nullptr;
+		MapStats stats;
 
 		void Close() noexcept;
 
+		void Map(const std::filesystem::directory_entry& file);
+
 	public:
 		explicit MemMapper(const std::filesystem::directory_entry& file);
+		MemMapper(const std::filesystem::directory_entry& file,
+							const MapOptions& options);
 		MemMapper(const MemMapper&) = delete;
 		MemMapper(MemMapper&& rhs) noexcept;
 
@@ -44,6 +49,12 @@ namespace AssetMap {
 
 		[[nodiscard]] uint8_t* Get() noexcept override;
 
+		void WillNeed(size_t offset, size_t len) noexcept override;
+
+		bool Lock(size_t offset, size_t len) noexcept override;
+
+		[[nodiscard]] const MapStats& Stats() const noexcept;
+
 		~MemMapper() noexcept override;
 	};
 } // namespace AssetMap
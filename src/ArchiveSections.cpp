@@ -0,0 +1,65 @@
+#include "ArchiveSections.h"
+
+#include <algorithm>
+
+using namespace AssetMap;
+
+ArchiveSections::ArchiveSections(const uint8_t* data, size_t len) noexcept {
+	if (len < sizeof(lam_size_t) + 1 || data[len - 1] != sectionedArchive)
+		return;
+	auto* countPtr = data + len - 1 - sizeof(lam_size_t);
+	begin					 = data;
+	count					 = GetLamSizeT(countPtr);
+	table					 = countPtr - count * recordSize;
+}
+
+std::pair<const uint8_t*, size_t>
+		ArchiveSections::Find(SectionId id) const noexcept {
+	for (lam_size_t i = 0; i < count; ++i) {
+		auto* record = table + i * recordSize;
+		if (GetValue<uint32_t>(record) != static_cast<uint32_t>(id))
+			continue;
+		auto offset = GetLamSizeT(record + sizeof(uint32_t));
+		auto size		= GetLamSizeT(record + sizeof(uint32_t) + sizeof(lam_size_t));
+		return {begin + offset, size};
+	}
+	return {nullptr, 0};
+}
+
+size_t ArchiveSections::Start() const noexcept {
+	if (begin == nullptr)
+		return 0;
+	auto start = static_cast<size_t>(table - begin);
+	for (lam_size_t i = 0; i < count; ++i)
+		start = std::min<size_t>(
+				start, GetLamSizeT(table + i * recordSize + sizeof(uint32_t)));
+	return start;
+}
+
+void SectionWriter::Add(SectionId id, std::vector<uint8_t> data) {
+	sections.emplace_back(id, std::move(data));
+}
+
+bool SectionWriter::Empty() const noexcept {
+	return sections.empty();
+}
+
+void SectionWriter::WriteTo(IArchiveWriter& out) const {
+	constexpr uint8_t padding[sizeof(lam_size_t)]{};
+	constexpr auto recordSize = ArchiveSections::recordSize;
+	std::vector<uint8_t> table(sections.size() * recordSize +
+														 sizeof(lam_size_t) + sizeof(uint8_t));
+	auto* record = table.data();
+	for (auto& [id, data] : sections) {
+		if (auto mod = out.Size() % sizeof(lam_size_t))
+			out.Write(padding, sizeof(lam_size_t) - mod);
+		PutValue<uint32_t>(record, static_cast<uint32_t>(id));
+		PutLamSizeT(record + sizeof(uint32_t), out.Size());
+		PutLamSizeT(record + sizeof(uint32_t) + sizeof(lam_size_t), data.size());
+		record += recordSize;
+		out.Write(data.data(), data.size());
+	}
+	PutLamSizeT(record, sections.size());
+	record[sizeof(lam_size_t)] = sectionedArchive;
+	out.Write(table.data(), table.size());
+}
@@ -0,0 +1,67 @@
+#include "ArchiveWriters.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace AssetMap;
+using namespace std::string_literals;
+
+namespace fs = std::filesystem;
+
+MappedWriter::MappedWriter(IMemMapper& file) : file{file} {}
+
+void MappedWriter::Reserve(size_t len) {
+	constexpr size_t minimumGrowth = 1 << 16;
+	if (size + len <= file.Size())
+		return;
+	file.Resize(std::max({size + len, file.Size() * 2, minimumGrowth}));
+}
+
+void MappedWriter::Write(const uint8_t* data, size_t len) {
+	Reserve(len);
+	std::copy(data, data + len, file.Get() + size);
+	size += len;
+}
+
+void MappedWriter::Overwrite(size_t offset, const uint8_t* data, size_t len) {
+	std::copy(data, data + len, file.Get() + offset);
+}
+
+void MappedWriter::Finish() {
+	file.Resize(size);
+}
+
+size_t MappedWriter::Size() const noexcept {
+	return size;
+}
+
+StreamWriter::StreamWriter(const fs::path& file, size_t bufferSize) :
+		buffer{std::make_unique<char[]>(bufferSize)} {
+	out.rdbuf()->pubsetbuf(buffer.get(), bufferSize);
+	out.open(file, std::ios::binary | std::ios::trunc);
+	if (!out)
+		throw std::runtime_error{"Unable to open "s + file.generic_u8string()};
+}
+
+void StreamWriter::Write(const uint8_t* data, size_t len) {
+	if (!out.write(reinterpret_cast<const char*>(data), len))
+		throw std::runtime_error{"Unable to write to archive"};
+	size += len;
+}
+
+void StreamWriter::Overwrite(size_t offset, const uint8_t* data, size_t len) {
+	out.seekp(offset);
+	out.write(reinterpret_cast<const char*>(data), len);
+	if (!out.seekp(0, std::ios::end))
+		throw std::runtime_error{"Unable to write to archive"};
+}
+
+void StreamWriter::Finish() {
+	out.close();
+	if (!out)
+		throw std::runtime_error{"Unable to complete archive"};
+}
+
+size_t StreamWriter::Size() const noexcept {
+	return size;
+}
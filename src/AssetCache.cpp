@@ -0,0 +1,92 @@
+#include "AssetCache.h"
+
+using namespace AssetMap;
+
+AssetCache::AssetCache(const MemMappedArchive& archive,
+											 size_t budget,
+											 unsigned shards) :
+		archive{archive} {
+	unsigned count = 1;
+	while (count < shards)
+		count <<= 1;
+	shardBudget	 = budget / count;
+	this->shards = std::vector<Shard>(count);
+}
+
+AssetCache::Shard& AssetCache::ShardOf(const uint8_t* key) noexcept {
+	// Entries are aligned, so the low bits carry nothing; mix the rest.
+	auto bits = uint64_t{reinterpret_cast<uintptr_t>(key)} * 0x9E3779B97F4A7C15ull;
+	return shards[(bits >> 32) & (shards.size() - 1)];
+}
+
+AssetCache::Buffer AssetCache::Retrieve(AssetId id) {
+	auto entry = archive[id];
+	auto key	 = entry.Compressed().first;
+	auto& shard = ShardOf(key);
+	{
+		std::lock_guard lock{shard.mtx};
+		if (auto it = shard.entries.find(key); it != shard.entries.end()) {
+			++shard.stats.hits;
+			shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+			return it->second->second;
+		}
+		++shard.stats.misses;
+	}
+
+	// Decompress without holding the lock so that other entries of the shard
+	// can still be retrieved meanwhile.
+	std::shared_ptr<uint8_t[]> data;
+	size_t len					= 0;
+	auto [buf, written] = entry.Retrieve([&](size_t size) {
+		len = size;
+		data.reset(new uint8_t[len]);
+		return data.get();
+	});
+	if (written != len)
+		return {};
+	Buffer ret{std::move(data), len};
+	if (len > shardBudget)
+		return ret;
+
+	std::lock_guard lock{shard.mtx};
+	if (auto it = shard.entries.find(key); it != shard.entries.end())
+		return it->second->second; // Another thread got here first.
+	while (shard.bytes + len > shardBudget) {
+		shard.bytes -= shard.lru.back().second.second;
+		shard.entries.erase(shard.lru.back().first);
+		shard.lru.pop_back();
+		++shard.stats.evictions;
+	}
+	shard.lru.emplace_front(key, ret);
+	shard.entries.emplace(key, shard.lru.begin());
+	shard.bytes += len;
+	return ret;
+}
+
+AssetCache::Buffer AssetCache::Retrieve(std::string_view name) {
+	if (auto id = archive.Resolve(name))
+		return Retrieve(*id);
+	return {};
+}
+
+AssetCache::Stats AssetCache::Statistics() {
+	Stats ret;
+	for (auto& shard : shards) {
+		std::lock_guard lock{shard.mtx};
+		ret.hits += shard.stats.hits;
+		ret.misses += shard.stats.misses;
+		ret.evictions += shard.stats.evictions;
+		ret.entries += shard.entries.size();
+		ret.bytes += shard.bytes;
+	}
+	return ret;
+}
+
+void AssetCache::Clear() {
+	for (auto& shard : shards) {
+		std::lock_guard lock{shard.mtx};
+		shard.entries.clear();
+		shard.lru.clear();
+		shard.bytes = 0;
+	}
+}
@@ -0,0 +1,80 @@
+#include "AssetHeader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+using namespace AssetMap;
+
+std::string AssetMap::AssetIdentifier(std::string_view name) {
+	std::string ret;
+	for (unsigned char c : name) {
+		if (std::isalnum(c))
+			ret.push_back(static_cast<char>(std::toupper(c)));
+		else if (ret.empty() || ret.back() != '_')
+			ret.push_back('_');
+	}
+	// Identifiers containing "__" or beginning with '_' and an upper-case
+	// letter are reserved.
+	if (ret.empty() || ret.front() == '_')
+		ret.insert(0, "ASSET");
+	else if (std::isdigit(static_cast<unsigned char>(ret.front())))
+		ret.insert(0, "ASSET_");
+	return ret;
+}
+
+//! Writes a name as a quoted string so that no character of it can end the
+//! comment it appears in, splice the next line onto it or form a trigraph.
+static void WriteQuoted(std::ostream& out, std::string_view name) {
+	out << '"';
+	char prev = 0;
+	for (unsigned char c : name) {
+		if (c == '"' || c == '\\' || (c == '?' && prev == '?'))
+			out << '\\' << static_cast<char>(c);
+		else if (std::iscntrl(c))
+			out << '\\' << std::oct << std::setfill('0') << std::setw(3)
+					<< static_cast<unsigned>(c) << std::dec;
+		else
+			out << static_cast<char>(c);
+		prev = static_cast<char>(c);
+	}
+	out << '"';
+}
+
+void AssetMap::WriteAssetHeader(const MemMappedArchive& archive,
+																std::ostream& out,
+																std::string_view nameSpace) {
+	auto fingerprint = archive.Fingerprint();
+	if (!fingerprint)
+		throw std::runtime_error{"The archive has no fingerprint"};
+	std::vector<std::pair<std::string_view, lam_size_t>> entries;
+	for (auto&& bucket : archive)
+		for (auto&& entry : bucket)
+			entries.emplace_back(entry.Name(), archive.OffsetOf(entry));
+	std::sort(entries.begin(), entries.end());
+
+	out << "// Generated by assetmapcli. Do not edit.\n"
+			<< "#pragma once\n\n"
+			<< "#include \"AssetId.h\"\n\n"
+			<< "#include <cstdint>\n\n"
+			<< "namespace " << nameSpace << " {\n"
+			<< "\t//! Pass to MemMappedArchive::RequireFingerprint() after opening.\n"
+			<< "\tconstexpr uint64_t fingerprint = 0x" << std::hex
+			<< std::setfill('0') << std::setw(16) << *fingerprint << std::dec
+			<< ";\n\n";
+	std::set<std::string> used;
+	for (auto& [name, offset] : entries) {
+		auto id		= AssetIdentifier(name);
+		auto base = id.back() == '_' ? id : id + '_';
+		for (auto i = 2; !used.insert(id).second; ++i)
+			id = base + std::to_string(i);
+		out << "\t//! ";
+		WriteQuoted(out, name);
+		out << '\n'
+				<< "\tconstexpr AssetMap::AssetId " << id << "{" << offset << "};\n";
+	}
+	out << "} // namespace " << nameSpace << '\n';
+}
@@ -0,0 +1,136 @@
+#include "AsyncLoader.h"
+#include "ThreadPool.h"
+
+#include <memory>
+#include <stdexcept>
+
+using namespace AssetMap;
+
+AsyncLoader::AsyncLoader(const MemMappedArchive& archive,
+												 unsigned threads,
+												 size_t budget) :
+		archive{archive}, budget{budget} {
+	if (threads == 0)
+		threads = ThreadPool::DefaultThreads();
+	this->threads.reserve(threads);
+	for (unsigned i = 0; i < threads; ++i)
+		this->threads.emplace_back([this] { Run(); });
+}
+
+bool AsyncLoader::Ready() const noexcept {
+	if (stopping)
+		return true;
+	if (order.empty())
+		return false;
+	auto size = pending.find(order.begin()->second)->second.size;
+	// An entry larger than the budget is read once nothing else is.
+	return budget == 0 || inFlight == 0 || inFlight + size <= budget;
+}
+
+void AsyncLoader::Run() noexcept {
+	for (;;) {
+		Request req;
+		{
+			std::unique_lock lock{mtx};
+			cv.wait(lock, [this] { return Ready(); });
+			if (stopping)
+				return;
+			auto ticket = order.begin()->second;
+			order.erase(order.begin());
+			auto it = pending.find(ticket);
+			req			= std::move(it->second);
+			pending.erase(it);
+			inFlight += req.size;
+		}
+		auto result = archive.Retrieve(req.request);
+		{
+			std::lock_guard lock{mtx};
+			inFlight -= req.size;
+		}
+		cv.notify_all();
+		Complete(req, std::move(result));
+	}
+}
+
+BatchResult AsyncLoader::Cancelled() {
+	BatchResult ret;
+	ret.error =
+			std::make_exception_ptr(std::runtime_error{"The load was cancelled"});
+	return ret;
+}
+
+void AsyncLoader::Complete(Request& req, BatchResult result) noexcept {
+	// Callbacks run on workers and in the destructor, neither of which can let
+	// an exception escape.
+	try {
+		req.done(std::move(result));
+	} catch (...) {
+	}
+}
+
+LoadTicket AsyncLoader::Load(const BatchRequest& request,
+														 int priority,
+														 Callback done) {
+	if (!done)
+		throw std::invalid_argument{"An AsyncLoader callback must not be empty"};
+	Request req{request,
+							-static_cast<int64_t>(priority),
+							archive[request.id].DecompressedSize(),
+							std::move(done)};
+	LoadTicket ticket;
+	{
+		std::lock_guard lock{mtx};
+		ticket.id = nextTicket++;
+		order.emplace(req.rank, ticket.id);
+		pending.emplace(ticket.id, std::move(req));
+	}
+	cv.notify_one();
+	return ticket;
+}
+
+std::pair<LoadTicket, std::future<BatchResult>>
+		AsyncLoader::Load(const BatchRequest& request, int priority) {
+	auto promise = std::make_shared<std::promise<BatchResult>>();
+	auto future	 = promise->get_future();
+	auto ticket	 = Load(request, priority, [promise](BatchResult result) {
+		 promise->set_value(std::move(result));
+	 });
+	return {ticket, std::move(future)};
+}
+
+bool AsyncLoader::Cancel(LoadTicket ticket) {
+	Request req;
+	{
+		std::lock_guard lock{mtx};
+		auto it = pending.find(ticket.id);
+		if (it == pending.end())
+			return false;
+		req = std::move(it->second);
+		order.erase({req.rank, ticket.id});
+		pending.erase(it);
+	}
+	// The new front of the queue may fit within the budget.
+	cv.notify_all();
+	Complete(req, Cancelled());
+	return true;
+}
+
+size_t AsyncLoader::Pending() {
+	std::lock_guard lock{mtx};
+	return pending.size();
+}
+
+AsyncLoader::~AsyncLoader() noexcept {
+	decltype(pending) cancelled;
+	{
+		std::lock_guard lock{mtx};
+		stopping = true;
+		order.clear();
+		cancelled.swap(pending);
+	}
+	cv.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+	for (auto& [ticket, req] : cancelled)
+		Complete(req, Cancelled());
+}
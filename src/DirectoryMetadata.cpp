@@ -1,22 +1,127 @@
 #include "DirectoryMetadata.h"
 #include "MemOps.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
 
 using namespace AssetMap;
 
 namespace fs = std::filesystem;
 
+namespace {
+	struct ScannedFile {
+		fs::directory_entry relative;
+		std::string name;
+		uintmax_t size;
+		uint64_t hash;
+	};
+
+	struct ScanJob {
+		fs::path absolute;
+		fs::path relative;
+	};
+
+	//! Lists a single directory. Every file in it is stat'ed and hashed in one
+	//! pass whilst its directory listing is still hot; subdirectories are
+	//! returned for the caller to schedule.
+	void ScanDirectory(const ScanJob& job,
+										 const IHasher& hasher,
+										 std::vector<ScannedFile>& files,
+										 std::vector<ScanJob>& subdirs) {
+		for (auto& file : fs::directory_iterator{job.absolute}) {
+			auto relative = job.relative / file.path().filename();
+			// Matches recursive_directory_iterator: symlinked dirs aren't followed.
+			if (file.is_directory() && !file.is_symlink()) {
+				subdirs.push_back({file.path(), std::move(relative)});
+				continue;
+			}
+			if (!file.is_regular_file())
+				continue;
+			auto name = relative.generic_u8string();
+			auto hash = hasher.Hash(name);
+			auto size = file.file_size();
+			files.push_back({fs::directory_entry{std::move(relative)},
+											 std::move(name),
+											 size,
+											 hash});
+		}
+	}
+
+	std::vector<ScannedFile> Scan(const IHasher& hasher,
+																const fs::directory_entry& ent,
+																unsigned threads) {
+		std::vector<ScannedFile> files;
+		std::vector<ScanJob> pending{{ent.path(), {}}};
+		if (threads == 0)
+			threads = ThreadPool::DefaultThreads();
+		if (threads < 2) {
+			while (!pending.empty()) {
+				auto job = std::move(pending.back());
+				pending.pop_back();
+				ScanDirectory(job, hasher, files, pending);
+			}
+			return files;
+		}
+		std::mutex mtx;
+		std::condition_variable cv;
+		size_t outstanding = 0;
+		std::exception_ptr error;
+		std::optional<ThreadPool> pool;
+		std::function<void(ScanJob)> submit = [&](ScanJob job) {
+			{
+				std::lock_guard lock{mtx};
+				++outstanding;
+			}
+			pool->Submit([&, job = std::move(job)](unsigned) {
+				std::vector<ScannedFile> found;
+				std::vector<ScanJob> subdirs;
+				try {
+					ScanDirectory(job, hasher, found, subdirs);
+				} catch (...) {
+					std::lock_guard lock{mtx};
+					error = std::current_exception();
+				}
+				for (auto& subdir : subdirs)
+					submit(std::move(subdir));
+				std::lock_guard lock{mtx};
+				std::move(found.begin(), found.end(), std::back_inserter(files));
+				if (--outstanding == 0)
+					cv.notify_all();
+			});
+		};
+		pool.emplace(threads);
+		submit(std::move(pending.back()));
+		std::unique_lock lock{mtx};
+		cv.wait(lock, [&] { return outstanding == 0; });
+		lock.unlock();
+		pool.reset();
+		if (error)
+			std::rethrow_exception(error);
+		return files;
+	}
+} // namespace
+
 DirectoryMetadata::DirectoryMetadata(const IHasher& hasher,
 																		 ICompress& comp,
-																		 const fs::directory_entry& ent) :
+																		 const fs::directory_entry& ent,
+																		 unsigned threads) :
 		dictionarySize{comp.Dictionary().second} {
-	std::vector<fs::directory_entry> files;
-	for (auto& file : fs::recursive_directory_iterator{ent}) {
-		if (!file.is_regular_file())
-			continue;
-		auto compressBound = comp.CalcCompressSize(file.file_size());
+	auto files = Scan(hasher, ent, threads);
+	// Directory iteration order is unspecified and differs between scans, so
+	// sort to keep archives reproducible.
+	std::sort(files.begin(), files.end(), [](auto& lhs, auto& rhs) {
+		return lhs.name < rhs.name;
+	});
+	for (auto& file : files) {
+		auto compressBound = comp.CalcCompressSize(file.size);
 		totalCompressBound += compressBound;
-		auto& name				= files.emplace_back(fs::relative(file, ent));
-		auto fileNameSize = name.path().generic_u8string().size() + 1;
+		auto fileNameSize = file.name.size() + 1;
 		totalFileNameSize += fileNameSize; // inc. \0
 		auto unalignedSize = sizeof(lam_size_t) + fileNameSize + compressBound;
 		auto mod					 = unalignedSize % sizeof(lam_size_t);
@@ -26,11 +131,9 @@ DirectoryMetadata::DirectoryMetadata(const IHasher& hasher,
 	const auto bucketTarget = hasher.CalcBucketsForItemCount(totalNumFiles);
 	buckets.resize(bucketTarget);
 	for (auto& file : files) {
-		auto bucketId =
-				hasher.CalcBucket(hasher.Hash(file.path().generic_u8string()),
-													bucketTarget);
-		auto& bucket = buckets[bucketId];
-		bucket.emplace_back(std::move(file));
+		auto bucketId = hasher.CalcBucket(file.hash, bucketTarget);
+		auto& bucket	= buckets[bucketId];
+		bucket.emplace_back(std::move(file.relative));
 	}
 }
 
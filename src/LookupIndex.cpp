@@ -0,0 +1,87 @@
+#include "LookupIndex.h"
+
+#include <algorithm>
+
+using namespace AssetMap;
+
+constexpr size_t headerSize = sizeof(lam_size_t) * 3;
+constexpr size_t recordSize = sizeof(uint32_t) + sizeof(lam_size_t) * 2;
+
+LookupIndex::LookupIndex(const uint8_t* data, size_t len) noexcept {
+	if (data == nullptr || len < headerSize)
+		return;
+	buckets		= GetLamSizeT(data);
+	count			= GetLamSizeT(data + sizeof(lam_size_t));
+	namesSize = GetLamSizeT(data + sizeof(lam_size_t) * 2);
+	heads			= data + headerSize;
+	records		= heads + (buckets + 1) * sizeof(lam_size_t);
+	names			= records + count * recordSize;
+}
+
+std::string_view LookupIndex::Name(lam_size_t record) const noexcept {
+	auto* rec		= records + record * recordSize + sizeof(uint32_t);
+	auto offset = GetLamSizeT(rec + sizeof(lam_size_t));
+	auto end		= namesSize;
+	if (record + 1 < count)
+		end = GetLamSizeT(rec + recordSize + sizeof(lam_size_t));
+	return {reinterpret_cast<const char*>(names + offset), end - offset};
+}
+
+std::optional<lam_size_t>
+		LookupIndex::Find(std::string_view name,
+											uint64_t hash,
+											lam_size_t bucket,
+											const NameTable& table) const noexcept {
+	auto tag	 = static_cast<uint32_t>(hash);
+	auto first = GetLamSizeT(heads + bucket * sizeof(lam_size_t));
+	auto last	 = GetLamSizeT(heads + (bucket + 1) * sizeof(lam_size_t));
+	for (auto i = first; i < last; ++i) {
+		auto* rec = records + i * recordSize;
+		if (GetValue<uint32_t>(rec) != tag)
+			continue;
+		auto nameOffset = GetLamSizeT(rec + sizeof(uint32_t) + sizeof(lam_size_t));
+		if (namesSize == 0 ? table && table.Equals(nameOffset, name)
+											 : Name(i) == name)
+			return GetLamSizeT(rec + sizeof(uint32_t));
+	}
+	return std::nullopt;
+}
+
+LookupIndex::operator bool() const noexcept {
+	return heads != nullptr;
+}
+
+std::vector<uint8_t> LookupIndex::Encode(lam_size_t buckets,
+																				 const std::vector<Record>& records,
+																				 bool shared) {
+	size_t namesSize = 0;
+	for (auto& record : records)
+		namesSize += shared ? 0 : record.name.size();
+	std::vector<uint8_t> ret(headerSize + (buckets + 1) * sizeof(lam_size_t) +
+													 records.size() * recordSize + namesSize);
+	PutLamSizeT(ret.data(), buckets);
+	PutLamSizeT(ret.data() + sizeof(lam_size_t), records.size());
+	PutLamSizeT(ret.data() + sizeof(lam_size_t) * 2, namesSize);
+	auto* heads = ret.data() + headerSize;
+	auto* rec		= heads + (buckets + 1) * sizeof(lam_size_t);
+	auto* names = rec + records.size() * recordSize;
+	lam_size_t i = 0, nameOffset = 0;
+	for (lam_size_t bucket = 0; bucket <= buckets; ++bucket) {
+		PutLamSizeT(heads + bucket * sizeof(lam_size_t), i);
+		for (; i < records.size() && records[i].bucket == bucket; ++i) {
+			auto& record = records[i];
+			PutValue<uint32_t>(rec, static_cast<uint32_t>(record.hash));
+			PutLamSizeT(rec + sizeof(uint32_t), record.entry);
+			if (shared) {
+				PutLamSizeT(rec + sizeof(uint32_t) + sizeof(lam_size_t),
+										record.ordinal);
+			} else {
+				PutLamSizeT(rec + sizeof(uint32_t) + sizeof(lam_size_t), nameOffset);
+				std::copy(record.name.begin(), record.name.end(), names + nameOffset);
+				nameOffset += record.name.size();
+			}
+			rec += recordSize;
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,64 @@
+#include "Manifest.h"
+
+using namespace AssetMap;
+
+constexpr size_t headerSize = sizeof(uint64_t) + sizeof(lam_size_t);
+constexpr size_t recordSize = sizeof(lam_size_t) + sizeof(uint64_t) * 3;
+
+Manifest::Manifest(const uint8_t* data, size_t len) noexcept {
+	if (data == nullptr || len < headerSize)
+		return;
+	settings = GetValue<uint64_t>(data);
+	count		 = GetLamSizeT(data + sizeof(uint64_t));
+	records	 = data + headerSize;
+}
+
+uint64_t Manifest::Settings() const noexcept {
+	return settings;
+}
+
+std::optional<SourceRecord>
+		Manifest::Find(lam_size_t offset) const noexcept {
+	lam_size_t lo = 0, hi = count;
+	while (lo < hi) {
+		auto mid		 = lo + (hi - lo) / 2;
+		auto* record = records + mid * recordSize;
+		auto entry	 = GetLamSizeT(record);
+		if (entry < offset) {
+			lo = mid + 1;
+		} else if (entry > offset) {
+			hi = mid;
+		} else {
+			record += sizeof(lam_size_t);
+			return SourceRecord{entry,
+													GetValue<uint64_t>(record),
+													static_cast<int64_t>(
+															GetValue<uint64_t>(record + sizeof(uint64_t))),
+													GetValue<uint64_t>(record + sizeof(uint64_t) * 2)};
+		}
+	}
+	return std::nullopt;
+}
+
+Manifest::operator bool() const noexcept {
+	return records != nullptr;
+}
+
+std::vector<uint8_t>
+		Manifest::Encode(uint64_t settings,
+										 const std::vector<SourceRecord>& records) {
+	std::vector<uint8_t> ret(headerSize + records.size() * recordSize);
+	PutValue<uint64_t>(ret.data(), settings);
+	PutLamSizeT(ret.data() + sizeof(uint64_t), records.size());
+	auto* out = ret.data() + headerSize;
+	for (auto& record : records) {
+		PutLamSizeT(out, record.entry);
+		out += sizeof(lam_size_t);
+		PutValue<uint64_t>(out, record.size);
+		PutValue<uint64_t>(out + sizeof(uint64_t),
+											 static_cast<uint64_t>(record.modified));
+		PutValue<uint64_t>(out + sizeof(uint64_t) * 2, record.contentHash);
+		out += sizeof(uint64_t) * 3;
+	}
+	return ret;
+}
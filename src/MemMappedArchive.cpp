@@ -1,75 +1,427 @@
 #include "MemMappedArchive.h"
 
+#include "ArchiveWriters.h"
 #include "DirectoryMetadata.h"
+#include "EntryFormat.h"
+#include "Manifest.h"
 #include "MemMappedBucket.h"
 #include "MemMapper.h"
 #include "MemOps.h"
+#include "ThreadPool.h"
 
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
 
 using namespace AssetMap;
 
 namespace fs = std::filesystem;
 
+struct Payload {
+	std::vector<uint8_t> data;
+	SourceRecord source;
+	uint8_t flags = 0;
+};
+
+//! Prepares payloads on a pool of workers and hands them back in order.
+class PayloadQueue {
+	using Prepare = std::function<Payload(size_t, ICompress&)>;
+
+	struct Slot {
+		Payload payload;
+		std::exception_ptr error;
+		bool done = false;
+	};
+
+	size_t count;
+	ICompress& comp;
+	Prepare prepare;
+	std::vector<std::unique_ptr<ICompress>> workerComp;
+	std::vector<Slot> slots;
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::optional<ThreadPool> pool; // must be destroyed first.
+
+	void Submit(size_t i) {
+		pool->Submit([this, i](unsigned worker) {
+			Slot result;
+			try {
+				result.payload = prepare(i, *workerComp[worker]);
+			} catch (...) {
+				result.error = std::current_exception();
+			}
+			result.done = true;
+			{
+				std::lock_guard lock{mtx};
+				slots[i % slots.size()] = std::move(result);
+			}
+			cv.notify_all();
+		});
+	}
+
+public:
+	PayloadQueue(size_t count, ICompress& comp, unsigned threads, Prepare prep) :
+			count{count}, comp{comp}, prepare{std::move(prep)} {
+		if (threads == 0)
+			threads = ThreadPool::DefaultThreads();
+		if (threads < 2 || count < 2)
+			return;
+		for (unsigned i = 0; i < threads; ++i)
+			workerComp.emplace_back(comp.Clone());
+		// Bound the number of compressed payloads held in memory whilst they
+		// wait to be written out in order.
+		slots.resize(std::min<size_t>(count, threads * 4));
+		pool.emplace(threads);
+		for (size_t i = 0; i < slots.size(); ++i)
+			Submit(i);
+	}
+
+	//! Payloads must be taken in order, each exactly once.
+	Payload Take(size_t i) {
+		if (!pool)
+			return prepare(i, comp);
+		Slot result;
+		{
+			std::unique_lock lock{mtx};
+			auto& slot = slots[i % slots.size()];
+			cv.wait(lock, [&slot] { return slot.done; });
+			result = std::move(slot);
+			slot	 = Slot{};
+		}
+		if (result.error)
+			std::rethrow_exception(result.error);
+		if (i + slots.size() < count)
+			Submit(i + slots.size());
+		return std::move(result.payload);
+	}
+};
+
 class ArchiveBuilder {
-	uint8_t* const begin;
-	uint8_t* const bucketsTbl;
-	uint8_t* nextBucket;
+	IArchiveWriter& out;
 	const fs::directory_entry& ent;
-	IMemMapper& file;
+	const IHasher& hasher;
 	ICompress& comp;
-	ptrdiff_t totalSize;
+	const BuildOptions& options;
+	uint32_t features = 0;
+	Manifest previous;
+	std::vector<SourceRecord> sources;
+	std::vector<std::pair<uint64_t, lam_size_t>> names;
+	std::string layout;
+	std::vector<LookupIndex::Record> lookup;
+	std::vector<std::pair<std::string, lam_size_t>> entryNames;
+	std::vector<uint8_t> table;
+	std::vector<uint8_t> scratch;
+	// source size, source hash and payload hash to the first entry's offset.
+	std::map<std::tuple<uint64_t, uint64_t, uint64_t>, lam_size_t> written;
+
+	bool TracksSources() const noexcept {
+		return options.manifest || options.previous || options.deduplicate;
+	}
+
+	uint64_t SettingsHash() const {
+		auto [dict, len] = comp.Dictionary();
+		auto settings		 = comp.Settings();
+		settings.push_back('\0');
+		settings.append(reinterpret_cast<const char*>(dict), dict ? len : 0);
+		return hasher.Hash(settings);
+	}
+
+	static std::vector<uint8_t>
+			Compress(const uint8_t* data, size_t len, ICompress& comp) {
+		std::vector<uint8_t> ret(comp.CalcCompressSize(len));
+		ret.resize(comp.Compress(data, len, ret.data(), ret.size()));
+		return ret;
+	}
+
+	//! Compresses every chunkSize bytes separately behind a table of where
+	//! each compressed chunk ends.
+	static std::vector<uint8_t> Chunk(const uint8_t* data,
+																		size_t len,
+																		size_t chunkSize,
+																		ICompress& comp) {
+		auto count = (len + chunkSize - 1) / chunkSize;
+		std::vector<uint8_t> ret(sizeof(lam_size_t) * (2 + count));
+		PutLamSizeT(ret.data(), chunkSize);
+		PutLamSizeT(ret.data() + sizeof(lam_size_t), len);
+		auto start = ret.size();
+		for (size_t i = 0; i < count; ++i) {
+			auto chunk = Compress(
+					data + i * chunkSize, std::min(chunkSize, len - i * chunkSize), comp);
+			ret.insert(ret.end(), chunk.begin(), chunk.end());
+			PutLamSizeT(ret.data() + sizeof(lam_size_t) * (2 + i),
+									ret.size() - start);
+		}
+		return ret;
+	}
+
+	static void Copy(const MemMappedBucketEntry& entry, Payload& payload) {
+		auto [data, len] = entry.Compressed();
+		payload.data.assign(data, data + len);
+		if (entry.Stored().first != nullptr)
+			payload.flags = entryStored;
+		else if (entry.Chunked())
+			payload.flags = entryChunked;
+	}
+
+	//! Keeps the file as-is if compressing it saves less than 1/32 of its size.
+	void Compress(const uint8_t* data,
+								size_t len,
+								ICompress& comp,
+								Payload& payload) const {
+		if (options.chunkSize != 0 && len > options.chunkSize) {
+			payload.data	= Chunk(data, len, options.chunkSize, comp);
+			payload.flags = entryChunked;
+		} else {
+			payload.data = Compress(data, len, comp);
+		}
+		if (options.store && payload.data.size() > len - len / 32) {
+			payload.data.assign(data, data + len);
+			payload.flags = entryStored;
+		}
+	}
+
+	Payload Prepare(const fs::directory_entry& file, ICompress& comp) const {
+		auto path = ent.path() / file;
+		Payload ret;
+		std::optional<SourceRecord> old;
+		MemMappedBucketEntry oldEntry{nullptr};
+		if (TracksSources()) {
+			ret.source.size			= fs::file_size(path);
+			ret.source.modified = fs::last_write_time(path).time_since_epoch().count();
+		}
+		if (options.previous) {
+			auto name = file.path().generic_u8string();
+			oldEntry	= (*options.previous)[name];
+			// Stored entries can only be kept if this archive may contain them.
+			if (oldEntry && oldEntry.Name() == name &&
+					(options.store || oldEntry.Stored().first == nullptr))
+				old = previous.Find(options.previous->OffsetOf(oldEntry));
+			// Nor can entries split into chunks other than those compressing the
+			// file now would produce.
+			if (old) {
+				auto chunk	 = options.chunkSize;
+				auto chunked = oldEntry.Chunked();
+				if (chunked != (chunk != 0 && old->size > chunk) ||
+						(chunked && GetLamSizeT(oldEntry.Compressed().first) != chunk))
+					old.reset();
+			}
+			if (old && old->size == ret.source.size &&
+					old->modified == ret.source.modified) {
+				ret.source.contentHash = old->contentHash;
+				Copy(oldEntry, ret);
+				return ret;
+			}
+		}
+		MemMapper src{fs::directory_entry{path}};
+		const uint8_t* data = src.Size() > 0 ? src.Get() : nullptr;
+		if (TracksSources()) {
+			ret.source.size = src.Size();
+			ret.source.contentHash =
+					hasher.Hash({reinterpret_cast<const char*>(data), src.Size()});
+			if (old && old->size == ret.source.size &&
+					old->contentHash == ret.source.contentHash) {
+				Copy(oldEntry, ret);
+				return ret;
+			}
+		}
+		Compress(data, src.Size(), comp, ret);
+		return ret;
+	}
+
+	//! Returns the offset of an earlier entry with identical contents, if any.
+	std::optional<lam_size_t> Duplicate(const Payload& payload) {
+		// An alias is no smaller than a payload this size.
+		if (!options.deduplicate || payload.data.size() <= sizeof(lam_size_t))
+			return std::nullopt;
+		auto payloadHash = hasher.Hash(
+				{reinterpret_cast<const char*>(payload.data.data()),
+				 payload.data.size()});
+		auto [it, inserted] = written.try_emplace(
+				{payload.source.size, payload.source.contentHash, payloadHash},
+				static_cast<lam_size_t>(out.Size()));
+		if (inserted)
+			return std::nullopt;
+		return it->second;
+	}
 
-	void AddLength(size_t len) noexcept {
-		totalSize += len;
-		nextBucket += len;
+	void WriteEntry(std::string_view name, const Payload& payload) {
+		// Enough for the entry, its name length, its flags, its worst-case
+		// padding and the zeroed header of the space following it.
+		scratch.assign(sizeof(lam_size_t) * 3 + sizeof(uint16_t) + name.size() +
+											 std::max(payload.data.size(), sizeof(lam_size_t)) + 3,
+									 0);
+		MemMappedBucketEntry entry{scratch.data(), comp, features};
+		size_t len;
+		if (auto target = Duplicate(payload))
+			len = entry.EmplaceAlias(name, out.Size() - *target);
+		else
+			len = entry.Emplace(
+					name, payload.data.data(), payload.data.size(), payload.flags);
+		out.Write(scratch.data(), len);
+	}
+
+	void WriteTags(const std::vector<fs::directory_entry>& bucket) {
+		scratch.assign(sizeof(lam_size_t) + bucket.size(), 0);
+		PutLamSizeT(scratch.data(), bucket.size());
+		for (size_t i = 0; i < bucket.size(); ++i) {
+			auto name = bucket[i].path().generic_u8string();
+			if (name.size() > std::numeric_limits<uint16_t>::max())
+				throw std::runtime_error{"The name " + name + " is too long"};
+			scratch[sizeof(lam_size_t) + i] = EntryTag(hasher.Hash(name));
+		}
+		auto mod = scratch.size() % sizeof(lam_size_t);
+		scratch.resize(scratch.size() + (mod ? sizeof(lam_size_t) - mod : 0));
+		out.Write(scratch.data(), scratch.size());
+	}
+
+	void WriteNull() {
+		scratch.assign(sizeof(lam_size_t) * 2 + sizeof(uint16_t) + 1, 0);
+		MemMappedBucketEntry entry{scratch.data(), comp, features};
+		out.Write(scratch.data(), entry.MakeNull());
 	}
 
 public:
+	using Buckets = std::vector<std::vector<fs::directory_entry>>;
+
 	ArchiveBuilder(const DirectoryMetadata& meta,
 								 const fs::directory_entry& ent,
-								 IMemMapper&& file,
-								 ICompress& comp) noexcept :
-			begin{file.Resize(meta.TotalRequiredSpace()).Get()},
-			bucketsTbl{begin + sizeof(lam_size_t)},
-			nextBucket{begin + meta.DataStart()},
+								 const IHasher& hasher,
+								 IArchiveWriter& out,
+								 ICompress& comp,
+								 const BuildOptions& options) :
+			out{out},
 			ent{ent},
-			file{file},
+			hasher{hasher},
 			comp{comp},
-			totalSize{meta.DataStart()} {
-		PutLamSizeT(begin, meta.Buckets().size());
+			options{options},
+			features{(options.deduplicate || options.store ? featureEntryFlags : 0) |
+							 (options.chunkSize ? featureEntryFlags | featureChunks : 0) |
+							 (options.bucketTags ? featureBucketTags : 0)},
+			table(meta.DataStart()) {
+		if (options.previous) {
+			auto [data, len] = options.previous->Section(SectionId::Manifest);
+			previous				 = Manifest{data, len};
+			if (!previous)
+				throw std::runtime_error{"The previous archive has no manifest"};
+			if (previous.Settings() != SettingsHash())
+				throw std::runtime_error{
+						"The previous archive was built with different compression "
+						"settings or a different dictionary"};
+		}
+		PutLamSizeT(table.data(), meta.Buckets().size());
+		out.Write(table.data(), table.size()); // filled in by Finish()
 	}
 
-	void Add(const std::vector<fs::directory_entry>& bucket, lam_size_t id) {
-		if (bucket.empty())
-			return;
-		MemMappedBucket mmBucket{begin, bucketsTbl, nextBucket - begin, id, comp};
-		for (auto& bEntry : bucket) {
-			fs::directory_entry fullPath{ent.path() / bEntry};
-			MemMapper src{fullPath};
-			AddLength(mmBucket.Append().Populate(bEntry.path().generic_u8string(),
-																					 src.Get(),
-																					 src.Size()));
+	void Add(const Buckets& buckets) {
+		std::vector<const fs::directory_entry*> files;
+		for (auto& bucket : buckets)
+			for (auto& file : bucket)
+				files.emplace_back(&file);
+		PayloadQueue payloads{
+				files.size(), comp, options.threads, [&](size_t i, ICompress& comp) {
+					return Prepare(*files[i], comp);
+				}};
+		size_t next = 0;
+		for (lam_size_t id = 0; id < buckets.size(); ++id) {
+			auto& bucket = buckets[id];
+			if (bucket.empty())
+				continue;
+			PutLamSizeT(table.data() + sizeof(lam_size_t) * (id + 1), out.Size());
+			if (features & featureBucketTags)
+				WriteTags(bucket);
+			for (auto& bEntry : bucket) {
+				auto payload = payloads.Take(next++);
+				if (options.manifest || options.previous) {
+					payload.source.entry = out.Size();
+					sources.push_back(payload.source);
+				}
+				auto name = bEntry.path().generic_u8string();
+				if (options.perfectHash)
+					names.emplace_back(hasher.Hash(name), out.Size());
+				if (options.lookupIndex)
+					lookup.push_back({id,
+														hasher.Hash(name),
+														static_cast<lam_size_t>(out.Size()),
+														name});
+				if (options.nameTable)
+					entryNames.emplace_back(name, out.Size());
+				if (options.fingerprint) {
+					uint8_t offset[sizeof(lam_size_t)];
+					PutLamSizeT(offset, out.Size());
+					layout.append(name).push_back('\0');
+					layout.append(reinterpret_cast<const char*>(offset), sizeof(offset));
+				}
+				WriteEntry(name, payload);
+			}
+			WriteNull();
 		}
-		AddLength(mmBucket.Append().MakeNull());
 	}
 
-	~ArchiveBuilder() noexcept(false) {
+	//! Also records the ordinal of each name in the lookup index.
+	std::vector<uint8_t> EncodeNames() {
+		std::sort(entryNames.begin(), entryNames.end());
+		std::unordered_map<lam_size_t, lam_size_t> ordinals;
+		for (lam_size_t i = 0; i < entryNames.size(); ++i)
+			ordinals[entryNames[i].second] = i;
+		for (auto& record : lookup)
+			record.ordinal = ordinals[record.entry];
+		return NameTable::Encode(entryNames);
+	}
+
+	void Finish() {
 		auto [dict, len]			= comp.Dictionary();
 		uint8_t hasDictionary = dict == nullptr ? 0 : 1;
-		if (hasDictionary) {
-			std::copy(dict, dict + len, begin + totalSize);
-			totalSize += len;
-			PutLamSizeT(begin + totalSize, len);
-			totalSize += sizeof(lam_size_t);
+		SectionWriter sections;
+		if (options.manifest || options.previous)
+			sections.Add(SectionId::Manifest,
+									 Manifest::Encode(SettingsHash(), sources));
+		if (options.perfectHash && !names.empty())
+			sections.Add(SectionId::PerfectHash, PerfectHashIndex::Encode(names));
+		if (options.nameTable)
+			sections.Add(SectionId::Names, EncodeNames());
+		if (options.lookupIndex)
+			sections.Add(SectionId::LookupIndex,
+									 LookupIndex::Encode(
+											 GetLamSizeT(table.data()), lookup, options.nameTable));
+		if (options.fingerprint) {
+			std::vector<uint8_t> fingerprint(sizeof(uint64_t));
+			PutValue<uint64_t>(fingerprint.data(), hasher.Hash(layout));
+			sections.Add(SectionId::Fingerprint, std::move(fingerprint));
+		}
+		if (features) {
+			std::vector<uint8_t> bits(sizeof(uint32_t));
+			PutValue(bits.data(), features);
+			sections.Add(SectionId::Features, std::move(bits));
 		}
-		begin[totalSize++] = hasDictionary;
-		file.Resize(totalSize);
+		if (!sections.Empty()) {
+			if (hasDictionary)
+				sections.Add(SectionId::Dictionary, {dict, dict + len});
+			sections.WriteTo(out);
+		} else {
+			if (hasDictionary) {
+				uint8_t dictLen[sizeof(lam_size_t)];
+				PutLamSizeT(dictLen, len);
+				out.Write(dict, len);
+				out.Write(dictLen, sizeof(dictLen));
+			}
+			out.Write(&hasDictionary, sizeof(hasDictionary));
+		}
+		out.Overwrite(0, table.data(), table.size());
+		out.Finish();
 	}
 };
 
-static uint8_t HasDictionary(const uint8_t* buf, lam_size_t len) noexcept {
+static uint8_t Version(const uint8_t* buf, lam_size_t len) noexcept {
 	return buf[len - 1];
 }
 
@@ -83,34 +435,111 @@ static std::pair<const uint8_t*, size_t>
 MemMappedArchive::MemMappedArchive(IMemMapper& file,
 																	 IDecompress& decomp,
 																	 const IHasher& hasher) :
-		file{file}, decomp{&decomp}, hasher{hasher} {
+		file{file},
+		source{file.OnDemand() ? &file : nullptr},
+		hasher{hasher},
+		decomp{&decomp} {
 	if (file.Size() == 0)
 		throw std::runtime_error{"Attempt to open an empty file as an archive. "
 														 "Did you call the wrong constructor?"};
-	auto hasDictionary = HasDictionary(file.Get(), file.Size());
-	if (hasDictionary == 1)
-		LoadDictionary(decomp);
-	else if (hasDictionary > 1)
+	if (source != nullptr)
+		ReadIndex();
+	auto version = Version(file.Get(), file.Size());
+	if (version > sectionedArchive)
 		throw std::runtime_error{"Attempt to open a file with a future version"};
+	LoadSections();
+	LoadDictionary(decomp);
 }
 
 MemMappedArchive::MemMappedArchive(const fs::directory_entry& ent,
 																	 const IHasher& hasher,
 																	 IMemMapper& file,
 																	 ICompress& comp,
-																	 IDecompress* decomp) :
-		file{file}, decomp{decomp}, hasher{hasher} {
-	DirectoryMetadata meta{hasher, comp, ent};
-	ArchiveBuilder builder{meta, ent, std::move(file), comp};
-	auto& buckets = meta.Buckets();
-	for (auto i = 0; i < buckets.size(); ++i)
-		builder.Add(buckets[i], i);
+																	 IDecompress* decomp,
+																	 const BuildOptions& options) :
+		file{file}, hasher{hasher}, decomp{decomp} {
+	MappedWriter out{file};
+	Build(ent, hasher, out, comp, options);
+	LoadSections();
+}
+
+void MemMappedArchive::Build(const fs::directory_entry& ent,
+														 const IHasher& hasher,
+														 IArchiveWriter& out,
+														 ICompress& comp,
+														 const BuildOptions& options) {
+	DirectoryMetadata meta{hasher, comp, ent, options.threads};
+	ArchiveBuilder builder{meta, ent, hasher, out, comp, options};
+	builder.Add(meta.Buckets());
+	builder.Finish();
+}
+
+void MemMappedArchive::ReadIndex() {
+	auto read = [this](size_t offset, size_t len) {
+		if (!file.Read(offset, len))
+			throw std::runtime_error{"Unable to read the archive"};
+	};
+	auto size			= file.Size();
+	auto trailer	= sizeof(lam_size_t) + sizeof(uint8_t);
+	auto tailFrom = [&](size_t len) { return len > size ? size : size - len; };
+	read(0, sizeof(lam_size_t));
+	read(0, sizeof(lam_size_t) * (BucketCount() + 1));
+	read(tailFrom(trailer), trailer);
+	switch (Version(file.Get(), size)) {
+		case 1: {
+			auto [dict, dictLen] = DictionaryInfo(file.Get(), size);
+			read(static_cast<size_t>(dict - file.Get()), dictLen);
+			break;
+		}
+		case sectionedArchive: {
+			auto count = GetLamSizeT(file.Get() + size - trailer);
+			read(tailFrom(count * ArchiveSections::recordSize + trailer),
+					 count * ArchiveSections::recordSize + trailer);
+			// Sections follow the last bucket, so they are read in one go.
+			auto start = ArchiveSections{file.Get(), size}.Start();
+			read(start, size - start);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void MemMappedArchive::LoadSections() {
+	sections				 = ArchiveSections{file.Get(), file.Size()};
+	auto [bits, len] = sections.Find(SectionId::Features);
+	if (bits != nullptr && len >= sizeof(uint32_t))
+		features = GetValue<uint32_t>(bits);
+	if (features & ~knownFeatures)
+		throw std::runtime_error{
+				"Attempt to open an archive using unsupported features"};
+	auto [perfect, perfectLen] = sections.Find(SectionId::PerfectHash);
+	index											 = PerfectHashIndex{perfect, perfectLen};
+
+	auto [lookupData, lookupLen] = sections.Find(SectionId::LookupIndex);
+	lookup											 = LookupIndex{lookupData, lookupLen};
+
+	auto [namesData, namesLen] = sections.Find(SectionId::Names);
+	names											 = NameTable{namesData, namesLen};
+}
+
+std::pair<const uint8_t*, size_t>
+		MemMappedArchive::Dictionary() const noexcept {
+	switch (Version(file.Get(), file.Size())) {
+		case 1:
+			return DictionaryInfo(file.Get(), file.Size());
+		case sectionedArchive:
+			return sections.Find(SectionId::Dictionary);
+		default:
+			return {nullptr, 0};
+	}
 }
 
 template <class Comp>
-void MemMappedArchive::LoadDictionary(Comp& comp) noexcept {
-	auto&& [dictBegin, dictLen] = DictionaryInfo(file.Get(), file.Size());
-	comp.UseDictionary(dictBegin, dictLen);
+void MemMappedArchive::LoadDictionary(Comp& comp) {
+	auto&& [dictBegin, dictLen] = Dictionary();
+	if (dictBegin != nullptr)
+		comp.UseDictionary(dictBegin, dictLen);
 }
 
 lam_size_t MemMappedArchive::BucketCount() const noexcept {
@@ -125,24 +554,266 @@ lam_size_t MemMappedArchive::EmptyBuckets() const noexcept {
 }
 
 lam_size_t MemMappedArchive::DictionarySize() const noexcept {
-	return HasDictionary(file.Get(), file.Size()) == 1
-						 ? DictionaryInfo(file.Get(), file.Size()).second
-						 : 0;
+	return Dictionary().second;
+}
+
+std::pair<const uint8_t*, size_t>
+		MemMappedArchive::Section(SectionId id) const noexcept {
+	return sections.Find(id);
+}
+
+std::optional<uint64_t> MemMappedArchive::Fingerprint() const noexcept {
+	auto [data, len] = sections.Find(SectionId::Fingerprint);
+	if (data == nullptr || len < sizeof(uint64_t))
+		return std::nullopt;
+	return GetValue<uint64_t>(data);
+}
+
+void MemMappedArchive::RequireFingerprint(uint64_t fingerprint) const {
+	if (Fingerprint() != fingerprint)
+		throw std::runtime_error{
+				"The asset IDs were generated for a different archive"};
+}
+
+uint32_t MemMappedArchive::Features() const noexcept {
+	return features;
+}
+
+lam_size_t MemMappedArchive::OffsetOf(
+		const MemMappedBucketEntry& entry) const noexcept {
+	return entry.Address() - file.Get();
 }
 
 MemMappedBucketEntry
 		MemMappedArchive::operator[](std::string_view name) const noexcept {
-	auto bucketId = hasher.CalcBucket(hasher.Hash(name), BucketCount());
-	return (*this)[bucketId][name];
+	return Find(name, hasher.Hash(name));
+}
+
+MemMappedBucketEntry MemMappedArchive::Find(std::string_view name,
+																						uint64_t hash) const noexcept {
+	if (index) {
+		assert(decomp != nullptr);
+		MemMappedBucketEntry entry{
+				file.Get() + index.Find(hash), *decomp, features, source};
+		return entry && entry.Name() == name ? entry
+																				 : MemMappedBucketEntry{nullptr};
+	}
+	auto bucketId = hasher.CalcBucket(hash, BucketCount());
+	if (lookup) {
+		assert(decomp != nullptr);
+		if (auto offset = lookup.Find(name, hash, bucketId, names))
+			return {file.Get() + *offset, *decomp, features, source};
+		return MemMappedBucketEntry{nullptr};
+	}
+	return (*this)[bucketId].Find(name, hash);
+}
+
+std::optional<AssetId>
+		MemMappedArchive::Resolve(std::string_view name) const noexcept {
+	return Resolve(name, hasher.Hash(name));
+}
+
+std::optional<AssetId>
+		MemMappedArchive::Resolve(std::string_view name,
+															uint64_t hash) const noexcept {
+	auto entry = Find(name, hash);
+	if (!entry || entry.Name() != name)
+		return std::nullopt;
+	return AssetId{OffsetOf(entry)};
+}
+
+MemMappedBucketEntry MemMappedArchive::operator[](AssetId id) const noexcept {
+	assert(decomp != nullptr);
+	return {file.Get() + id.offset, *decomp, features, source};
 }
 
 MemMappedBucket MemMappedArchive::operator[](lam_size_t idx) const noexcept {
 	assert(decomp != nullptr);
 	auto* begin = file.Get();
-	MemMappedBucket bucket{file.Get(), begin + sizeof(lam_size_t), idx, *decomp};
+	MemMappedBucket bucket{file.Get(),
+												 begin + sizeof(lam_size_t),
+												 idx,
+												 *decomp,
+												 features,
+												 source};
 	return bucket;
 }
 
+static bool GlobMatch(std::string_view pattern, std::string_view name) noexcept {
+	while (!pattern.empty()) {
+		if (pattern.substr(0, 2) == "**") {
+			pattern.remove_prefix(2);
+			for (size_t i = 0; i <= name.size(); ++i)
+				if (GlobMatch(pattern, name.substr(i)))
+					return true;
+			return false;
+		}
+		if (pattern.front() == '*') {
+			pattern.remove_prefix(1);
+			for (size_t i = 0;; ++i) {
+				if (GlobMatch(pattern, name.substr(i)))
+					return true;
+				if (i == name.size() || name[i] == '/')
+					return false;
+			}
+		}
+		if (name.empty())
+			return false;
+		if (pattern.front() == '?' ? name.front() == '/'
+															 : pattern.front() != name.front())
+			return false;
+		pattern.remove_prefix(1);
+		name.remove_prefix(1);
+	}
+	return name.empty();
+}
+
+std::vector<std::pair<std::string, AssetId>> MemMappedArchive::Query(
+		std::string_view prefix,
+		const std::function<bool(std::string_view)>& filter) const {
+	std::vector<std::pair<std::string, AssetId>> ret;
+	if (names) {
+		auto [first, last] = names.PrefixRange(prefix);
+		names.Visit(first, last, [&](auto i, auto name) {
+			if (filter(name))
+				ret.emplace_back(name, AssetId{names.Entry(i)});
+		});
+		return ret;
+	}
+	for (auto&& bucket : *this)
+		for (auto&& entry : bucket)
+			if (auto name = entry.Name();
+					name.substr(0, prefix.size()) == prefix && filter(name))
+				ret.emplace_back(name, AssetId{OffsetOf(entry)});
+	std::sort(ret.begin(), ret.end(), [](auto& lhs, auto& rhs) {
+		return lhs.first < rhs.first;
+	});
+	return ret;
+}
+
+std::vector<std::pair<std::string, AssetId>>
+		MemMappedArchive::List(std::string_view prefix) const {
+	return Query(prefix, [](auto) { return true; });
+}
+
+std::vector<std::pair<std::string, AssetId>>
+		MemMappedArchive::Glob(std::string_view pattern) const {
+	auto prefix = pattern.substr(0, pattern.find_first_of("*?"));
+	return Query(prefix, [pattern](auto name) {
+		return GlobMatch(pattern, name);
+	});
+}
+
+BatchResult MemMappedArchive::Retrieve(const BatchRequest& request) const {
+	return Retrieve((*this)[request.id], request);
+}
+
+BatchResult MemMappedArchive::Retrieve(MemMappedBucketEntry entry,
+																			 const BatchRequest& request) {
+	BatchResult result;
+	try {
+		size_t len					= 0;
+		auto [dst, written] = entry.Retrieve([&](size_t size) {
+			len = size;
+			if (request.buffer == nullptr) {
+				result.data.reset(new uint8_t[len]);
+				return result.data.get();
+			}
+			if (request.capacity < len)
+				throw std::runtime_error{"Buffer too small for " +
+																 std::string{entry.Name()}};
+			return request.buffer;
+		});
+		if (written != len)
+			throw std::runtime_error{"Failed to decompress " +
+															 std::string{entry.Name()}};
+		result.size = len;
+	} catch (...) {
+		result.data.reset();
+		result.error = std::current_exception();
+	}
+	return result;
+}
+
+std::vector<BatchResult>
+		MemMappedArchive::RetrieveBatch(const std::vector<BatchRequest>& requests,
+																		ThreadPool& pool) const {
+	std::vector<BatchResult> results(requests.size());
+	std::vector<std::pair<const uint8_t*, size_t>> order;
+	order.reserve(requests.size());
+	for (size_t i = 0; i < requests.size(); ++i)
+		order.emplace_back((*this)[requests[i].id].Compressed().first, i);
+	std::sort(order.begin(), order.end());
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	auto remaining = requests.size();
+	for (auto [src, i] : order) {
+		pool.Submit([&, i = i](unsigned) {
+			results[i] = Retrieve(requests[i]);
+			std::lock_guard lock{mtx};
+			if (--remaining == 0)
+				cv.notify_one();
+		});
+	}
+	std::unique_lock lock{mtx};
+	cv.wait(lock, [&remaining] { return remaining == 0; });
+	return results;
+}
+
+std::vector<BatchResult>
+		MemMappedArchive::RetrieveBatch(const std::vector<std::string_view>& names,
+																		ThreadPool& pool) const {
+	std::vector<BatchResult> results(names.size());
+	std::vector<BatchRequest> requests;
+	std::vector<size_t> found;
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (auto id = Resolve(names[i])) {
+			requests.push_back({*id});
+			found.push_back(i);
+		} else {
+			results[i].error = std::make_exception_ptr(
+					std::runtime_error{"No such entry: " + std::string{names[i]}});
+		}
+	}
+	auto read = RetrieveBatch(requests, pool);
+	for (size_t i = 0; i < found.size(); ++i)
+		results[found[i]] = std::move(read[i]);
+	return results;
+}
+
+void MemMappedArchive::Prefetch(const std::vector<AssetId>& ids) const {
+	// Nearby entries are usually in the same or adjacent pages, so merge them
+	// into as few ranges as possible.
+	constexpr size_t gap = 4096;
+	std::vector<std::pair<size_t, size_t>> ranges;
+	ranges.reserve(ids.size());
+	for (auto id : ids) {
+		auto [data, len] = (*this)[id].Compressed();
+		if (data == nullptr)
+			continue;
+		auto offset			 = static_cast<size_t>(data - file.Get());
+		ranges.emplace_back(offset, offset + len);
+	}
+	std::sort(ranges.begin(), ranges.end());
+	for (size_t i = 0; i < ranges.size();) {
+		auto [start, end] = ranges[i];
+		for (++i; i < ranges.size() && ranges[i].first <= end + gap; ++i)
+			end = std::max(end, ranges[i].second);
+		file.WillNeed(start, end - start);
+	}
+}
+
+bool MemMappedArchive::LockIndex() const noexcept {
+	auto locked = file.Lock(0, sizeof(lam_size_t) * (BucketCount() + 1));
+	for (auto id :
+			 {SectionId::LookupIndex, SectionId::PerfectHash, SectionId::Names}) {
+		if (auto [data, len] = Section(id); data != nullptr)
+			locked = file.Lock(data - file.Get(), len) && locked;
+	}
+	return locked;
+}
+
 MemMappedArchive::Iterator MemMappedArchive::begin() const noexcept {
 	return {*this, 0};
 }
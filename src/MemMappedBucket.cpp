@@ -1,8 +1,56 @@
 #include "MemMappedBucket.h"
+#include "EntryFormat.h"
 #include "MemOps.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+		(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LIBASSETMAP_SSE2
+#	include <emmintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	endif
+#endif
+
 using namespace AssetMap;
 
+#ifdef LIBASSETMAP_SSE2
+static unsigned LowestBit(unsigned mask) noexcept {
+#	ifdef _MSC_VER
+	unsigned long ret;
+	_BitScanForward(&ret, mask);
+	return ret;
+#	else
+	return __builtin_ctz(mask);
+#	endif
+}
+#endif
+
+//! Calls \c match with the index of every tag equal to \c tag, in order,
+//! until it returns true.
+template <class Match>
+static bool FindTags(const uint8_t* tags,
+										 size_t count,
+										 uint8_t tag,
+										 Match&& match) noexcept {
+	size_t i = 0;
+#ifdef LIBASSETMAP_SSE2
+	auto needle = _mm_set1_epi8(static_cast<char>(tag));
+	for (; i + 16 <= count; i += 16) {
+		auto block =
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + i));
+		auto mask = static_cast<unsigned>(
+				_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+		for (; mask != 0; mask &= mask - 1)
+			if (match(i + LowestBit(mask)))
+				return true;
+	}
+#endif
+	for (; i < count; ++i)
+		if (tags[i] == tag && match(i))
+			return true;
+	return false;
+}
+
 MemMappedBucket::Iterator::Iterator(MemMappedBucketEntry&& entry) :
 		entry{std::move(entry)} {}
 
@@ -16,7 +64,7 @@ MemMappedBucketEntry& MemMappedBucket::Iterator::operator->() noexcept {
 
 MemMappedBucket::Iterator& MemMappedBucket::Iterator::operator++() noexcept {
 	++entry;
-	if (entry.Name().empty())
+	if (!entry || entry.Name().empty())
 		entry = MemMappedBucketEntry{nullptr};
 	return *this;
 }
@@ -32,22 +80,49 @@ bool MemMappedBucket::Iterator::operator!=(const Iterator& rhs) const noexcept {
 MemMappedBucket::MemMappedBucket(uint8_t* begin,
 																 uint8_t* bucketsTbl,
 																 lam_size_t id,
-																 IDecompress& decomp) noexcept :
+																 IDecompress& decomp,
+																 uint32_t features,
+																 IMemMapper* source) noexcept :
 		data{begin + GetLamSizeT(bucketsTbl + (id * sizeof(lam_size_t)))},
-		next{data, decomp},
-		decomp{&decomp} {
-	if (data == begin)
+		next{data, decomp, features},
+		decomp{&decomp},
+		source{source},
+		features{features} {
+	if (data == begin) {
 		data = nullptr;
+		return;
+	}
+	if (features & featureBucketTags) {
+		auto load = [&](size_t len) {
+			return source == nullptr ||
+						 source->Read(static_cast<size_t>(data - source->Get()), len);
+		};
+		if (!load(sizeof(lam_size_t)) ||
+				!load(sizeof(lam_size_t) + GetLamSizeT(data))) {
+			data = nullptr;
+			return;
+		}
+		count		 = GetLamSizeT(data);
+		tags		 = data + sizeof(lam_size_t);
+		auto len = sizeof(lam_size_t) + count;
+		auto mod = len % sizeof(lam_size_t);
+		data += len + (mod ? sizeof(lam_size_t) - mod : 0);
+		next = MemMappedBucketEntry{data, decomp, features};
+	}
 }
 
 MemMappedBucket::MemMappedBucket(uint8_t* begin,
 																 uint8_t* bucketsTbl,
 																 ptrdiff_t offset,
 																 lam_size_t bucketId,
-																 ICompress& comp) noexcept :
-		data{begin + offset}, next{data, comp}, comp{&comp} {
+																 ICompress& comp,
+																 uint32_t features) noexcept :
+		data{begin + offset},
+		next{data, comp, features},
+		comp{&comp},
+		features{features} {
 	PutLamSizeT(bucketsTbl + (bucketId * sizeof(lam_size_t)), offset);
-	static_cast<void>(MemMappedBucketEntry{data, comp}.MakeNull());
+	static_cast<void>(MemMappedBucketEntry{data, comp, features}.MakeNull());
 }
 
 MemMappedBucketEntry MemMappedBucket::Append() noexcept {
@@ -63,10 +138,26 @@ MemMappedBucketEntry MemMappedBucket::operator[](std::string_view name) const {
 	return MemMappedBucketEntry{nullptr};
 }
 
+MemMappedBucketEntry MemMappedBucket::Find(std::string_view name,
+																					 uint64_t hash) const noexcept {
+	if (tags == nullptr)
+		return (*this)[name];
+	MemMappedBucketEntry entry{data, *decomp, features, source};
+	size_t position = 0;
+	auto match			= [&](size_t i) {
+		 for (; position < i && entry; ++position)
+			 ++entry;
+		 return entry && entry.Name() == name;
+	};
+	if (!FindTags(tags, count, EntryTag(hash), match))
+		return MemMappedBucketEntry{nullptr};
+	return entry;
+}
+
 MemMappedBucket::Iterator MemMappedBucket::begin() const noexcept {
 	if (data == nullptr)
 		return end();
-	return Iterator{MemMappedBucketEntry{data, *decomp}};
+	return Iterator{MemMappedBucketEntry{data, *decomp, features, source}};
 }
 
 MemMappedBucket::Iterator MemMappedBucket::end() const noexcept {
@@ -1,51 +1,192 @@
 #include "MemMappedBucketEntry.h"
 
+#include "EntryFormat.h"
 #include "MemOps.h"
 
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
 using namespace AssetMap;
 
-MemMappedBucketEntry::MemMappedBucketEntry(uint8_t* data, ICompress& comp) :
-		data{data}, comp{&comp} {}
+MemMappedBucketEntry::MemMappedBucketEntry(uint8_t* data,
+																					 ICompress& comp,
+																					 uint32_t features) :
+		data{data}, comp{&comp}, features{features} {}
 
-MemMappedBucketEntry::MemMappedBucketEntry(uint8_t* data, IDecompress& decomp) :
-		data{data}, decomp{&decomp} {}
+MemMappedBucketEntry::MemMappedBucketEntry(uint8_t* data,
+																					 IDecompress& decomp,
+																					 uint32_t features,
+																					 IMemMapper* source) :
+		data{data}, decomp{&decomp}, source{source}, features{features} {
+	if (source != nullptr && data != nullptr)
+		LoadHeader();
+}
 
 MemMappedBucketEntry::MemMappedBucketEntry(std::nullptr_t) {}
 
+bool MemMappedBucketEntry::Load(const uint8_t* from,
+																size_t len) const noexcept {
+	return source == nullptr ||
+				 source->Read(static_cast<size_t>(from - source->Get()), len);
+}
+
+void MemMappedBucketEntry::LoadHeader() noexcept {
+	// Room for the longest name a bucket tag can describe, plus the distance
+	// stored by an alias, so that longer entries are not read in full.
+	constexpr size_t maxHeader = sizeof(lam_size_t) * 2 + sizeof(uint16_t) +
+															 UINT16_MAX + sizeof(uint8_t) * 2;
+	if (!Load(data, sizeof(lam_size_t))) {
+		data = nullptr;
+		return;
+	}
+	size_t len	= sizeof(lam_size_t) + GetLamSizeT(data);
+	auto loaded = std::min(len, maxHeader);
+	if (!Load(data, loaded)) {
+		data = nullptr;
+		return;
+	}
+	// Without bucket tags, names are only bounded by their terminator.
+	if (!(features & featureBucketTags) && loaded < len &&
+			!std::memchr(data + NameOffset(), 0, loaded - NameOffset()) &&
+			!Load(data, len))
+		data = nullptr;
+}
+
+bool MemMappedBucketEntry::LoadData() const noexcept {
+	if (source == nullptr)
+		return true;
+	return data != nullptr && Load(data, sizeof(lam_size_t) + GetLamSizeT(data));
+}
+
+size_t MemMappedBucketEntry::NameOffset() const noexcept {
+	if (features & featureBucketTags)
+		return sizeof(lam_size_t) + sizeof(uint16_t);
+	return sizeof(lam_size_t);
+}
+
+size_t MemMappedBucketEntry::HeaderSize() const noexcept {
+	auto len = NameOffset() + Name().size() + 1;
+	return features & featureEntryFlags ? len + sizeof(uint8_t) : len;
+}
+
+lam_size_t MemMappedBucketEntry::StoredSize() const noexcept {
+	return GetLamSizeT(data) - (HeaderSize() - sizeof(lam_size_t));
+}
+
+const uint8_t* MemMappedBucketEntry::Target() const noexcept {
+	if (!(Flags() & entryAlias))
+		return data;
+	return data - GetLamSizeT(FileData());
+}
+
+MemMappedBucketEntry MemMappedBucketEntry::Resolve() const noexcept {
+	auto ret = *this;
+	if (data == nullptr)
+		return ret;
+	ret.data = const_cast<uint8_t*>(Target());
+	if (source != nullptr && ret.data != data)
+		ret.LoadHeader();
+	return ret;
+}
+
 lam_size_t MemMappedBucketEntry::FileSize() const noexcept {
-	return GetLamSizeT(data) - (Name().size() + 1);
+	return static_cast<lam_size_t>(Compressed().second);
 }
 
 size_t MemMappedBucketEntry::InMemorySize() const noexcept {
-	auto len = sizeof(lam_size_t) + Name().size() + 1 + FileSize();
-	auto mod = len % sizeof(lam_size_t);
+	size_t len = sizeof(lam_size_t) + GetLamSizeT(data);
+	auto mod	 = len % sizeof(lam_size_t);
 	len += mod ? sizeof(lam_size_t) - mod : 0;
 	return len;
 }
 
 void MemMappedBucketEntry::FileSize(lam_size_t size) {
-	PutLamSizeT(data, size + (Name().size() + 1));
+	PutLamSizeT(data, size + (HeaderSize() - sizeof(lam_size_t)));
 }
 
 lam_size_t MemMappedBucketEntry::DecompressedSize() const noexcept {
-	return decomp->CalcDecompressSize(FileData(), FileSize());
+	auto target = Resolve();
+	if (!target.LoadData())
+		return 0;
+	auto* src		= target.FileData();
+	auto flags	= target.Flags();
+	if (flags & entryStored)
+		return target.StoredSize();
+	if (flags & entryChunked)
+		return GetLamSizeT(src + sizeof(lam_size_t));
+	return decomp->CalcDecompressSize(src, target.StoredSize());
+}
+
+std::pair<const uint8_t*, size_t>
+		MemMappedBucketEntry::Compressed() const noexcept {
+	auto target = Resolve();
+	if (!target.LoadData())
+		return {nullptr, 0};
+	return {target.FileData(), target.StoredSize()};
+}
+
+std::pair<const uint8_t*, size_t>
+		MemMappedBucketEntry::Stored() const noexcept {
+	auto target = Resolve();
+	if (!target.LoadData() || !(target.Flags() & entryStored))
+		return {nullptr, 0};
+	return {target.FileData(), target.StoredSize()};
+}
+
+std::pair<const uint8_t*, size_t>
+		MemMappedBucketEntry::Extent() const noexcept {
+	auto target = Resolve();
+	if (!target.LoadData())
+		return {nullptr, 0};
+	return {target.data, target.HeaderSize() + target.StoredSize()};
+}
+
+MemMappedBucketEntry MemMappedBucketEntry::Rebase(uint8_t* copy) const noexcept {
+	auto ret		= *this;
+	ret.data		= copy;
+	ret.source = nullptr;
+	return ret;
+}
+
+bool MemMappedBucketEntry::Chunked() const noexcept {
+	auto target = Resolve();
+	return target.data != nullptr && target.Flags() & entryChunked;
+}
+
+const uint8_t* MemMappedBucketEntry::Address() const noexcept {
+	return data;
+}
+
+uint8_t MemMappedBucketEntry::Flags() const noexcept {
+	if (!(features & featureEntryFlags))
+		return 0;
+	return data[NameOffset() + Name().size() + 1];
 }
 
 std::string_view MemMappedBucketEntry::Name() const noexcept {
-	return {reinterpret_cast<const char*>(data + sizeof(lam_size_t))};
+	auto* name = reinterpret_cast<const char*>(data + NameOffset());
+	if (features & featureBucketTags)
+		return {name, GetValue<uint16_t>(data + sizeof(lam_size_t))};
+	return {name};
 }
 
 void MemMappedBucketEntry::Name(std::string_view name) noexcept {
 	auto* str = name.data();
 	auto len	= name.size();
-	std::copy(str, str + len, data + sizeof(lam_size_t));
-	data[sizeof(lam_size_t) + len] = '\0';
+	if (features & featureBucketTags)
+		PutValue<uint16_t>(data + sizeof(lam_size_t), len);
+	std::copy(str, str + len, data + NameOffset());
+	data[NameOffset() + len] = '\0';
 }
 
 size_t MemMappedBucketEntry::Populate(std::string_view name,
 																			const uint8_t* ptr,
 																			size_t len) noexcept {
 	Name(name);
+	if (features & featureEntryFlags)
+		data[HeaderSize() - 1] = 0;
 	auto compBound = comp->CalcCompressSize(len);
 	len						 = comp->Compress(ptr, len, FileData(), compBound);
 	FileSize(len);
@@ -57,33 +198,224 @@ size_t MemMappedBucketEntry::Populate(std::string_view name,
 	return InMemorySize();
 }
 
+size_t MemMappedBucketEntry::Emplace(std::string_view name,
+																		 const uint8_t* ptr,
+																		 size_t len,
+																		 uint8_t flags) noexcept {
+	Name(name);
+	if (features & featureEntryFlags)
+		data[HeaderSize() - 1] = flags;
+	std::copy(ptr, ptr + len, FileData());
+	FileSize(len);
+	auto zeroBegin = FileData() + len;
+	auto zeroEnd	 = data + InMemorySize() + sizeof(lam_size_t) + sizeof(uint8_t);
+	std::fill(zeroBegin, zeroEnd, 0);
+	return InMemorySize();
+}
+
+size_t MemMappedBucketEntry::EmplaceAlias(std::string_view name,
+																					lam_size_t distance) noexcept {
+	uint8_t payload[sizeof(lam_size_t)];
+	PutLamSizeT(payload, distance);
+	return Emplace(name, payload, sizeof(payload), entryAlias);
+}
+
 std::pair<std::unique_ptr<uint8_t[]>, size_t> MemMappedBucketEntry::Retrieve() {
-	auto len	= decomp->CalcDecompressSize(FileData(), FileSize());
-	auto ret	= std::make_unique<uint8_t[]>(len);
-	auto* buf = ret.get();
-	return {std::move(ret), Retrieve(buf, len)};
+	std::unique_ptr<uint8_t[]> ret;
+	// Not make_unique: the buffer is about to be overwritten anyway.
+	auto [buf, len] = Retrieve([&ret](size_t len) {
+		ret.reset(new uint8_t[len]);
+		return ret.get();
+	});
+	return {std::move(ret), len};
 }
 
 size_t MemMappedBucketEntry::Retrieve(uint8_t* buf, size_t len) {
-	return decomp->Decompress(FileData(), FileSize(), buf, len);
+	if (auto [src, srcLen] = Stored(); src != nullptr) {
+		len = std::min(len, srcLen);
+		std::copy(src, src + len, buf);
+		return len;
+	}
+	if (Chunked())
+		return Retrieve(0, buf, len);
+	auto [src, srcLen] = Compressed();
+	if (src == nullptr)
+		return 0;
+	return decomp->Decompress(src, srcLen, buf, len);
+}
+
+size_t MemMappedBucketEntry::Stream(const IDecompress::Sink& sink) {
+	// The size of the blocks stored data is handed over in.
+	constexpr size_t blockSize = 128 * 1024;
+	auto target = Resolve();
+	if (!target.LoadData())
+		throw std::runtime_error{"Unable to read " + std::string{Name()}};
+	auto* src		= target.FileData();
+	auto srcLen = target.StoredSize();
+	auto flags	= target.Flags();
+	if (flags & entryStored) {
+		for (size_t pos = 0; pos < srcLen; pos += blockSize)
+			if (!sink(src + pos, std::min(blockSize, srcLen - pos)))
+				return pos + std::min(blockSize, srcLen - pos);
+		return srcLen;
+	}
+	if (!(flags & entryChunked))
+		return decomp->DecompressStream(src, srcLen, sink);
+	size_t chunkSize = GetLamSizeT(src);
+	size_t size			 = GetLamSizeT(src + sizeof(lam_size_t));
+	auto count			 = (size + chunkSize - 1) / chunkSize;
+	auto* ends			 = src + sizeof(lam_size_t) * 2;
+	auto* chunks		 = ends + sizeof(lam_size_t) * count;
+	size_t total = 0, begin = 0;
+	bool stopped = false;
+	auto forward = [&](const uint8_t* data, size_t len) {
+		stopped = !sink(data, len);
+		return !stopped;
+	};
+	for (size_t i = 0; i < count && !stopped; ++i) {
+		size_t end = GetLamSizeT(ends + sizeof(lam_size_t) * i);
+		total += decomp->DecompressStream(chunks + begin, end - begin, forward);
+		begin = end;
+	}
+	return total;
+}
+
+size_t MemMappedBucketEntry::Retrieve(size_t offset, uint8_t* buf, size_t len) {
+	auto target = Resolve();
+	if (target.data == nullptr)
+		return 0;
+	auto* src		= target.FileData();
+	auto srcLen = target.StoredSize();
+	auto flags	= target.Flags();
+	// Only the chunks covering the range are read from chunked entries.
+	if (!(flags & entryChunked) && !target.LoadData())
+		return 0;
+	if (flags & entryStored) {
+		if (offset >= srcLen)
+			return 0;
+		len = std::min(len, srcLen - offset);
+		std::copy(src + offset, src + offset + len, buf);
+		return len;
+	}
+	if (!(flags & entryChunked)) {
+		// A single frame can only be decompressed as a whole.
+		size_t size = decomp->CalcDecompressSize(src, srcLen);
+		if (offset >= size)
+			return 0;
+		if (offset == 0 && len >= size)
+			return decomp->Decompress(src, srcLen, buf, size);
+		std::unique_ptr<uint8_t[]> tmp{new uint8_t[size]};
+		if (decomp->Decompress(src, srcLen, tmp.get(), size) != size)
+			return 0;
+		len = std::min(len, size - offset);
+		std::copy(tmp.get() + offset, tmp.get() + offset + len, buf);
+		return len;
+	}
+
+	if (!target.Load(src, sizeof(lam_size_t) * 2))
+		return 0;
+	size_t chunkSize = GetLamSizeT(src);
+	size_t size			 = GetLamSizeT(src + sizeof(lam_size_t));
+	if (offset >= size)
+		return 0;
+	len					 = std::min(len, size - offset);
+	auto count	 = (size + chunkSize - 1) / chunkSize;
+	auto* ends	 = src + sizeof(lam_size_t) * 2;
+	auto* chunks = ends + sizeof(lam_size_t) * count;
+	if (!target.Load(ends, sizeof(lam_size_t) * count))
+		return 0;
+	std::unique_ptr<uint8_t[]> tmp;
+	size_t written = 0;
+	for (auto i = offset / chunkSize; written < len; ++i) {
+		auto* end			= ends + sizeof(lam_size_t) * i;
+		auto begin		= i == 0 ? 0 : GetLamSizeT(end - sizeof(lam_size_t));
+		auto chunkLen = std::min(chunkSize, size - i * chunkSize);
+		auto skip			= offset + written - i * chunkSize;
+		auto want			= std::min(chunkLen - skip, len - written);
+		// Whole chunks are decompressed straight into the destination.
+		auto* dst = skip == 0 && want == chunkLen ? buf + written : nullptr;
+		if (dst == nullptr) {
+			if (!tmp)
+				tmp.reset(new uint8_t[chunkSize]);
+			dst = tmp.get();
+		}
+		auto chunkEnd = GetLamSizeT(end);
+		if (!target.Load(chunks + begin, chunkEnd - begin))
+			return written;
+		if (decomp->Decompress(
+						chunks + begin, chunkEnd - begin, dst, chunkLen) != chunkLen)
+			return written;
+		if (dst == tmp.get())
+			std::copy(dst + skip, dst + skip + want, buf + written);
+		written += want;
+	}
+	return written;
+}
+
+std::pair<uint8_t*, size_t> MemMappedBucketEntry::Retrieve(
+		const std::function<uint8_t*(size_t)>& allocate) {
+	auto target = Resolve();
+	if (!target.LoadData())
+		throw std::runtime_error{"Unable to read " + std::string{Name()}};
+	auto* src		= target.FileData();
+	auto srcLen = target.StoredSize();
+	auto flags	= target.Flags();
+	if (flags & entryStored) {
+		auto* buf = allocate(srcLen);
+		std::copy(src, src + srcLen, buf);
+		return {buf, srcLen};
+	}
+	if (flags & entryChunked) {
+		auto len	= GetLamSizeT(src + sizeof(lam_size_t));
+		auto* buf = allocate(len);
+		return {buf, Retrieve(0, buf, len)};
+	}
+	auto len	= decomp->CalcDecompressSize(src, srcLen);
+	auto* buf = allocate(len);
+	return {buf, decomp->Decompress(src, srcLen, buf, len)};
+}
+
+std::pair<uint8_t*, size_t>
+		MemMappedBucketEntry::Retrieve(std::pmr::memory_resource& resource) {
+	size_t allocated = 0;
+	uint8_t* buf		 = nullptr;
+	try {
+		auto ret = Retrieve([&](size_t len) {
+			if (len != 0)
+				buf = static_cast<uint8_t*>(
+						resource.allocate(len, alignof(std::max_align_t)));
+			allocated = len;
+			return buf;
+		});
+		if (ret.second != allocated)
+			throw std::runtime_error{"Failed to decompress " + std::string{Name()}};
+		return ret;
+	} catch (...) {
+		if (buf != nullptr)
+			resource.deallocate(buf, allocated, alignof(std::max_align_t));
+		throw;
+	}
 }
 
 size_t MemMappedBucketEntry::MakeNull() noexcept {
 	Name({});
-	FileSize(0);
+	// just the name; terminators never carry flags.
+	PutLamSizeT(data, NameOffset() - sizeof(lam_size_t) + 1);
 	return InMemorySize();
 }
 
 uint8_t* MemMappedBucketEntry::FileData() noexcept {
-	return data + sizeof(lam_size_t) + Name().size() + 1;
+	return data + HeaderSize();
 }
 
 const uint8_t* MemMappedBucketEntry::FileData() const noexcept {
-	return data + sizeof(lam_size_t) + Name().size() + 1;
+	return data + HeaderSize();
 }
 
 MemMappedBucketEntry& MemMappedBucketEntry::operator++() noexcept {
 	data += InMemorySize();
+	if (source != nullptr)
+		LoadHeader();
 	return *this;
 }
 
@@ -0,0 +1,203 @@
+#include "NameTable.h"
+
+#include <algorithm>
+
+using namespace AssetMap;
+
+static size_t ReadVarint(const uint8_t*& pos) noexcept {
+	size_t ret = 0;
+	for (unsigned shift = 0;; shift += 7) {
+		auto byte = *pos++;
+		ret |= static_cast<size_t>(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return ret;
+	}
+}
+
+static void WriteVarint(std::vector<uint8_t>& out, size_t value) {
+	for (; value >= 0x80; value >>= 7)
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+static size_t CommonPrefix(std::string_view lhs, std::string_view rhs) noexcept {
+	auto [l, r] = std::mismatch(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	return l - lhs.begin();
+}
+
+NameTable::NameTable(const uint8_t* data, size_t len) noexcept {
+	if (data == nullptr || len < sizeof(lam_size_t))
+		return;
+	count		= GetLamSizeT(data);
+	blocks	= data + sizeof(lam_size_t);
+	entries = blocks + (count + blockSize - 1) / blockSize * sizeof(lam_size_t);
+	names		= entries + count * sizeof(lam_size_t);
+}
+
+//! Walks the names of \c block, calling \c visit with the ordinal of each
+//! and how it compares to \c name (<0, 0 or >0) until \c visit returns true.
+//!
+//! Names are compared as they are decoded without assembling them: \c match is
+//! the length of the prefix the current name shares with \c name and \c next
+//! the character following it in the current name. A name that shares more
+//! with its predecessor than its predecessor did with \c name differs from
+//! \c name at the same position and in the same way.
+template <class Visitor>
+void NameTable::Scan(lam_size_t block,
+										 std::string_view name,
+										 Visitor&& visit) const noexcept {
+	auto* pos = names + GetLamSizeT(blocks + block * sizeof(lam_size_t));
+	auto first = block * blockSize;
+	auto last	 = std::min(first + blockSize, count);
+	size_t match = 0, len = 0;
+	int next		 = -1;
+	for (auto i = first; i < last; ++i) {
+		auto shared = ReadVarint(pos);
+		auto suffix = ReadVarint(pos);
+		std::string_view rest{reinterpret_cast<const char*>(pos), suffix};
+		pos += suffix;
+		len = shared + suffix;
+		if (shared <= match) {
+			match = shared + CommonPrefix(name.substr(std::min(shared, name.size())),
+																		rest);
+			next	= match < len ? static_cast<uint8_t>(rest[match - shared]) : -1;
+		}
+		int cmp;
+		if (match == len && match == name.size())
+			cmp = 0;
+		else if (match == len)
+			cmp = -1;
+		else if (match == name.size())
+			cmp = 1;
+		else
+			cmp = next - static_cast<uint8_t>(name[match]);
+		if (visit(i, cmp))
+			return;
+	}
+}
+
+lam_size_t NameTable::Size() const noexcept {
+	return count;
+}
+
+std::string NameTable::Name(lam_size_t ordinal) const {
+	auto* pos =
+			names + GetLamSizeT(blocks + (ordinal / blockSize) * sizeof(lam_size_t));
+	std::string ret;
+	for (auto i = ordinal - ordinal % blockSize; i <= ordinal; ++i) {
+		auto shared = ReadVarint(pos);
+		auto suffix = ReadVarint(pos);
+		ret.resize(shared);
+		ret.append(reinterpret_cast<const char*>(pos), suffix);
+		pos += suffix;
+	}
+	return ret;
+}
+
+bool NameTable::Equals(lam_size_t ordinal,
+											 std::string_view name) const noexcept {
+	bool ret = false;
+	Scan(ordinal / blockSize, name, [&](auto i, int cmp) {
+		ret = cmp == 0;
+		return i == ordinal;
+	});
+	return ret;
+}
+
+lam_size_t NameTable::Entry(lam_size_t ordinal) const noexcept {
+	return GetLamSizeT(entries + ordinal * sizeof(lam_size_t));
+}
+
+lam_size_t NameTable::LowerBound(std::string_view name) const noexcept {
+	// Find the last block whose first name does not sort after name.
+	lam_size_t lo = 0, hi = (count + blockSize - 1) / blockSize;
+	while (lo < hi) {
+		auto mid		= lo + (hi - lo) / 2;
+		auto* first = names + GetLamSizeT(blocks + mid * sizeof(lam_size_t));
+		ReadVarint(first);
+		auto len = ReadVarint(first);
+		if (std::string_view{reinterpret_cast<const char*>(first), len} <= name)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return 0;
+	auto ret = std::min(lo * blockSize, count);
+	Scan(lo - 1, name, [&](auto i, int cmp) {
+		if (cmp < 0)
+			return false;
+		ret = i;
+		return true;
+	});
+	return ret;
+}
+
+std::pair<lam_size_t, lam_size_t>
+		NameTable::PrefixRange(std::string_view prefix) const noexcept {
+	auto first = LowerBound(prefix);
+	// The smallest string that sorts after everything beginning with prefix.
+	while (!prefix.empty() && static_cast<uint8_t>(prefix.back()) == 0xff)
+		prefix.remove_suffix(1);
+	if (prefix.empty())
+		return {first, count};
+	std::string next{prefix};
+	next.back() = static_cast<char>(static_cast<uint8_t>(next.back()) + 1);
+	return {first, LowerBound(next)};
+}
+
+void NameTable::Visit(
+		lam_size_t first,
+		lam_size_t last,
+		const std::function<void(lam_size_t, std::string_view)>& visit) const {
+	if (first >= last)
+		return;
+	auto* pos =
+			names + GetLamSizeT(blocks + (first / blockSize) * sizeof(lam_size_t));
+	std::string name;
+	for (auto i = first - first % blockSize; i < last; ++i) {
+		auto shared = ReadVarint(pos);
+		auto suffix = ReadVarint(pos);
+		name.resize(shared);
+		name.append(reinterpret_cast<const char*>(pos), suffix);
+		pos += suffix;
+		if (i >= first)
+			visit(i, name);
+	}
+}
+
+std::optional<lam_size_t>
+		NameTable::Find(std::string_view name) const noexcept {
+	auto ret = LowerBound(name);
+	if (ret < count && Equals(ret, name))
+		return ret;
+	return std::nullopt;
+}
+
+NameTable::operator bool() const noexcept {
+	return names != nullptr;
+}
+
+std::vector<uint8_t> NameTable::Encode(
+		const std::vector<std::pair<std::string, lam_size_t>>& names) {
+	auto blocks = (names.size() + blockSize - 1) / blockSize;
+	std::vector<uint8_t> ret(sizeof(lam_size_t) * (1 + blocks + names.size()));
+	PutLamSizeT(ret.data(), names.size());
+	auto namesStart = ret.size();
+	std::string_view previous;
+	for (size_t i = 0; i < names.size(); ++i) {
+		auto& [name, entry] = names[i];
+		size_t shared				= 0;
+		if (i % blockSize == 0)
+			PutLamSizeT(ret.data() + sizeof(lam_size_t) * (1 + i / blockSize),
+									ret.size() - namesStart);
+		else
+			shared = CommonPrefix(previous, name);
+		PutLamSizeT(ret.data() + sizeof(lam_size_t) * (1 + blocks + i), entry);
+		WriteVarint(ret, shared);
+		WriteVarint(ret, name.size() - shared);
+		ret.insert(ret.end(), name.begin() + shared, name.end());
+		previous = name;
+	}
+	return ret;
+}
@@ -0,0 +1,105 @@
+#include "PerfectHash.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+using namespace AssetMap;
+
+constexpr size_t headerSize		 = sizeof(lam_size_t) * 2;
+constexpr size_t keysPerGroup	 = 4;
+constexpr uint64_t goldenRatio = 0x9E3779B97F4A7C15;
+
+static uint64_t Mix(uint64_t z) noexcept {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+	return z ^ (z >> 31);
+}
+
+static size_t Slot(uint64_t hash, uint64_t seed, size_t slots) noexcept {
+	return Mix(hash + (seed + 1) * goldenRatio) % slots;
+}
+
+PerfectHashIndex::PerfectHashIndex(const uint8_t* data, size_t len) noexcept {
+	if (data == nullptr || len < headerSize)
+		return;
+	slots		= GetLamSizeT(data);
+	groups	= GetLamSizeT(data + sizeof(lam_size_t));
+	seeds		= data + headerSize;
+	entries = seeds + groups * sizeof(lam_size_t);
+}
+
+lam_size_t PerfectHashIndex::Find(uint64_t hash) const noexcept {
+	auto group = Mix(hash) % groups;
+	auto seed	 = GetLamSizeT(seeds + group * sizeof(lam_size_t));
+	return GetLamSizeT(entries + Slot(hash, seed, slots) * sizeof(lam_size_t));
+}
+
+PerfectHashIndex::operator bool() const noexcept {
+	return slots != 0;
+}
+
+std::vector<uint8_t> PerfectHashIndex::Encode(
+		const std::vector<std::pair<uint64_t, lam_size_t>>& keys) {
+	if (keys.empty())
+		return {};
+	std::vector<uint64_t> hashes(keys.size());
+	std::transform(keys.begin(), keys.end(), hashes.begin(), [](auto& key) {
+		return key.first;
+	});
+	std::sort(hashes.begin(), hashes.end());
+	if (std::adjacent_find(hashes.begin(), hashes.end()) != hashes.end())
+		throw std::runtime_error{
+				"Unable to build a perfect hash; two entries share a hash"};
+
+	size_t slots	= keys.size();
+	size_t groups = (slots + keysPerGroup - 1) / keysPerGroup;
+	std::vector<std::vector<size_t>> members(groups);
+	for (size_t i = 0; i < keys.size(); ++i)
+		members[Mix(keys[i].first) % groups].push_back(i);
+
+	// Placing the largest groups first, whilst most slots are still free, keeps
+	// the number of seeds that have to be tried for each group low.
+	std::vector<size_t> order(groups);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+		return members[lhs].size() > members[rhs].size();
+	});
+
+	std::vector<uint8_t> ret(headerSize + (groups + slots) * sizeof(lam_size_t));
+	PutLamSizeT(ret.data(), slots);
+	PutLamSizeT(ret.data() + sizeof(lam_size_t), groups);
+	auto* seeds		= ret.data() + headerSize;
+	auto* entries = seeds + groups * sizeof(lam_size_t);
+	std::vector<bool> taken(slots);
+	std::vector<size_t> placed;
+	for (auto group : order) {
+		auto& keyIds = members[group];
+		if (keyIds.empty())
+			break;
+		for (uint64_t seed = 0;; ++seed) {
+			if (seed > std::numeric_limits<lam_size_t>::max())
+				throw std::runtime_error{
+						"Unable to build a perfect hash; ran out of seeds"};
+			placed.clear();
+			for (auto id : keyIds) {
+				auto slot = Slot(keys[id].first, seed, slots);
+				if (taken[slot] ||
+						std::find(placed.begin(), placed.end(), slot) != placed.end())
+					break;
+				placed.push_back(slot);
+			}
+			if (placed.size() != keyIds.size())
+				continue;
+			PutLamSizeT(seeds + group * sizeof(lam_size_t), seed);
+			for (size_t i = 0; i < keyIds.size(); ++i) {
+				taken[placed[i]] = true;
+				PutLamSizeT(entries + placed[i] * sizeof(lam_size_t),
+										keys[keyIds[i]].second);
+			}
+			break;
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,107 @@
+#include "ReadMapper.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+using namespace AssetMap;
+
+namespace fs = std::filesystem;
+
+//! Which blocks have been read, and the stream they are read from.
+struct ReadMapper::Blocks {
+	size_t size;
+	//! Set, with release semantics, once a block's bytes have been read.
+	std::unique_ptr<std::atomic<bool>[]> done;
+	std::atomic<size_t> bytesRead{0};
+	std::mutex mtx; // guards in and writes to the buffer.
+	std::ifstream in;
+
+	Blocks(const fs::path& path, size_t size, size_t count) :
+			size{size},
+			done{new std::atomic<bool>[count]()},
+			in{path, std::ios::binary} {}
+};
+
+ReadMapper::ReadMapper(const fs::directory_entry& file, size_t blockSize) :
+		len{static_cast<size_t>(file.file_size())} {
+	blockSize = std::max<size_t>(blockSize, 1);
+	blocks		= std::make_unique<Blocks>(
+			 file.path(), blockSize, (len + blockSize - 1) / blockSize);
+	if (!blocks->in)
+		throw std::runtime_error{"Unable to open " +
+														 file.path().generic_u8string()};
+	// Not make_unique: only the blocks that are read are ever touched, so
+	// large allocations are not committed up front by most systems.
+	data.reset(new uint8_t[len]);
+}
+
+ReadMapper::ReadMapper(ReadMapper&&) noexcept = default;
+
+ReadMapper& ReadMapper::operator=(ReadMapper&&) noexcept = default;
+
+IMemMapper& ReadMapper::Resize(size_t) {
+	throw std::runtime_error{"A ReadMapper cannot be resized"};
+}
+
+size_t ReadMapper::Size() const noexcept {
+	return len;
+}
+
+const uint8_t* ReadMapper::Get() const noexcept {
+	return len ? data.get() : nullptr;
+}
+
+uint8_t* ReadMapper::Get() noexcept {
+	return len ? data.get() : nullptr;
+}
+
+bool ReadMapper::OnDemand() const noexcept {
+	return true;
+}
+
+bool ReadMapper::Read(size_t offset, size_t count) noexcept {
+	if (offset >= len || count == 0)
+		return count == 0;
+	auto first = offset / blocks->size;
+	auto last	 = (offset + std::min(count, len - offset) - 1) / blocks->size;
+	auto ready = [this](size_t i) {
+		return blocks->done[i].load(std::memory_order_acquire);
+	};
+	auto i = first;
+	while (i <= last && ready(i))
+		++i;
+	if (i > last)
+		return true;
+	std::lock_guard lock{blocks->mtx};
+	while (i <= last) {
+		if (ready(i)) {
+			++i;
+			continue;
+		}
+		// Read every missing block up to the next one present at once.
+		auto end = i + 1;
+		while (end <= last && !ready(end))
+			++end;
+		auto begin = i * blocks->size;
+		auto size	 = std::min(end * blocks->size, len) - begin;
+		blocks->in.seekg(static_cast<std::streamoff>(begin));
+		if (!blocks->in.read(reinterpret_cast<char*>(data.get() + begin),
+												 static_cast<std::streamsize>(size))) {
+			blocks->in.clear();
+			return false;
+		}
+		blocks->bytesRead += size;
+		for (; i < end; ++i)
+			blocks->done[i].store(true, std::memory_order_release);
+	}
+	return true;
+}
+
+size_t ReadMapper::BytesRead() const noexcept {
+	return blocks->bytesRead;
+}
+
+ReadMapper::~ReadMapper() noexcept = default;
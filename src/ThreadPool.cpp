@@ -0,0 +1,53 @@
+#include "ThreadPool.h"
+
+using namespace AssetMap;
+
+ThreadPool::ThreadPool(unsigned threads) {
+	if (threads == 0)
+		threads = DefaultThreads();
+	this->threads.reserve(threads);
+	for (unsigned i = 0; i < threads; ++i)
+		this->threads.emplace_back([this, i] { Run(i); });
+}
+
+void ThreadPool::Run(unsigned worker) noexcept {
+	for (;;) {
+		std::function<void(unsigned)> task;
+		{
+			std::unique_lock lock{mtx};
+			cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task(worker);
+	}
+}
+
+void ThreadPool::Submit(std::function<void(unsigned)> task) {
+	{
+		std::lock_guard lock{mtx};
+		tasks.emplace_back(std::move(task));
+	}
+	cv.notify_one();
+}
+
+unsigned ThreadPool::Size() const noexcept {
+	return threads.size();
+}
+
+unsigned ThreadPool::DefaultThreads() noexcept {
+	auto count = std::thread::hardware_concurrency();
+	return count ? count : 1;
+}
+
+ThreadPool::~ThreadPool() noexcept {
+	{
+		std::lock_guard lock{mtx};
+		stopping = true;
+	}
+	cv.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+}
@@ -1,7 +1,9 @@
 #include "ZSTDComp.h"
 
 #include <fstream>
+#include <new>
 #include <numeric>
+#include <stdexcept>
 #include <type_traits>
 
 #include "dictBuilder/zdict.h"
@@ -16,6 +18,7 @@
 #endif
 
 using namespace AssetMap;
+using namespace std::string_literals;
 
 namespace fs = std::filesystem;
 
@@ -59,13 +62,16 @@ constexpr void ZCtx<Ctx>::Create() {
 
 template <class Ctx>
 void ZCtx<Ctx>::Dispose() {
-	constexpr auto isCctx = std::is_same_v<Ctx, ZSTD_CCtx>,
-								 isDctx = std::is_same_v<Ctx, ZSTD_DCtx>;
-	static_assert(OneOf<isCctx, isDctx>());
-	if constexpr (std::is_same_v<Ctx, ZSTD_CCtx>)
+	constexpr auto isCctx	 = std::is_same_v<Ctx, ZSTD_CCtx>,
+								 isDctx	 = std::is_same_v<Ctx, ZSTD_DCtx>,
+								 isDDict = std::is_same_v<Ctx, ZSTD_DDict>;
+	static_assert(OneOf<isCctx, isDctx, isDDict>());
+	if constexpr (isCctx)
 		ZSTD_freeCCtx(ctx);
-	else if constexpr (std::is_same_v<Ctx, ZSTD_DCtx>)
+	else if constexpr (isDctx)
 		ZSTD_freeDCtx(ctx);
+	else if constexpr (isDDict)
+		ZSTD_freeDDict(ctx);
 	ctx = nullptr;
 }
 
@@ -89,7 +95,8 @@ ZSTD::ZSTD(float dictRatio) noexcept : dictRatio{dictRatio} {}
 
 ZSTD::ZSTD(both_t, float dictRatio) : ZSTD{dictRatio} {
 	cCtx.Create();
-	dCtx.Create();
+	dCtxs.emplace_back().Create();
+	decompressing = true;
 }
 
 ZSTD::ZSTD(compress_t, float dictRatio) : ZSTD{dictRatio} {
@@ -97,12 +104,15 @@ ZSTD::ZSTD(compress_t, float dictRatio) : ZSTD{dictRatio} {
 }
 
 ZSTD::ZSTD(decompress_t) {
-	dCtx.Create();
+	dCtxs.emplace_back().Create();
+	decompressing = true;
 }
 
 ZSTD::ZSTD(ZSTD&& rhs) noexcept :
 		cCtx{std::move(rhs.cCtx)},
-		dCtx{std::move(rhs.dCtx)},
+		dDict{std::move(rhs.dDict)},
+		dCtxs{std::move(rhs.dCtxs)},
+		decompressing{rhs.decompressing},
 		dictionary{rhs.dictionary},
 		dictLen{rhs.dictLen},
 		generatedDictionary{std::move(rhs.generatedDictionary)} {
@@ -112,10 +122,12 @@ ZSTD::ZSTD(ZSTD&& rhs) noexcept :
 
 ZSTD& ZSTD::operator=(ZSTD&& rhs) noexcept {
 	cCtx								= std::move(rhs.cCtx);
-	dCtx								= std::move(rhs.dCtx);
+	dDict								= std::move(rhs.dDict);
+	dCtxs								= std::move(rhs.dCtxs);
+	decompressing				= rhs.decompressing;
 	dictionary					= rhs.dictionary;
 	dictLen							= rhs.dictLen;
-	generatedDictionary = std::move(generatedDictionary);
+	generatedDictionary = std::move(rhs.generatedDictionary);
 	rhs.dictionary			= nullptr;
 	rhs.dictLen					= 0;
 	return *this;
@@ -128,11 +140,76 @@ size_t ZSTD::Compress(const uint8_t* src,
 	return ZSTD_compress2(cCtx, dst, dstLen, src, srcLen);
 }
 
+ZCtx<ZSTD_DCtx> ZSTD::AcquireDCtx() {
+	{
+		std::lock_guard lock{dCtxMtx};
+		if (!dCtxs.empty()) {
+			auto ctx = std::move(dCtxs.back());
+			dCtxs.pop_back();
+			return ctx;
+		}
+	}
+	ZCtx<ZSTD_DCtx> ctx;
+	ctx.Create();
+	if (!ctx)
+		throw std::bad_alloc{};
+	return ctx;
+}
+
+void ZSTD::ReleaseDCtx(ZCtx<ZSTD_DCtx> ctx) noexcept {
+	std::lock_guard lock{dCtxMtx};
+	try {
+		dCtxs.emplace_back(std::move(ctx));
+	} catch (...) {
+		// The context is freed instead of being reused.
+	}
+}
+
 size_t ZSTD::Decompress(const uint8_t* src,
 												size_t srcLen,
 												uint8_t* dst,
 												size_t dstLen) {
-	return ZSTD_decompressDCtx(dCtx, dst, dstLen, src, srcLen);
+	auto ctx = AcquireDCtx();
+	auto ret = ZSTD_decompress_usingDDict(ctx, dst, dstLen, src, srcLen, dDict);
+	ReleaseDCtx(std::move(ctx));
+	return ret;
+}
+
+size_t ZSTD::DecompressStream(const uint8_t* src,
+															size_t srcLen,
+															const Sink& sink) {
+	auto ctx = AcquireDCtx();
+	ZSTD_DCtx_reset(ctx, ZSTD_reset_session_and_parameters);
+	ZSTD_DCtx_refDDict(ctx, dDict);
+	auto blockLen = ZSTD_DStreamOutSize();
+	std::unique_ptr<uint8_t[]> block{new uint8_t[blockLen]};
+	ZSTD_inBuffer in{src, srcLen, 0};
+	size_t total = 0;
+	try {
+		for (;;) {
+			ZSTD_outBuffer out{block.get(), blockLen, 0};
+			auto ret = ZSTD_decompressStream(ctx, &out, &in);
+			if (ZSTD_isError(ret))
+				throw std::runtime_error{"Decompression failed: "s +
+																 ZSTD_getErrorName(ret)};
+			total += out.pos;
+			if (out.pos > 0 && !sink(block.get(), out.pos))
+				break;
+			// 0 means a frame is complete and fully flushed.
+			if (in.pos == in.size && (ret == 0 || out.pos < out.size)) {
+				if (ret != 0)
+					throw std::runtime_error{"Truncated compressed data"};
+				break;
+			}
+		}
+	} catch (...) {
+		ZSTD_DCtx_reset(ctx, ZSTD_reset_session_and_parameters);
+		ReleaseDCtx(std::move(ctx));
+		throw;
+	}
+	ZSTD_DCtx_reset(ctx, ZSTD_reset_session_and_parameters);
+	ReleaseDCtx(std::move(ctx));
+	return total;
 }
 
 size_t ZSTD::CalcCompressSize(size_t len) const noexcept {
@@ -196,13 +273,20 @@ bool ZSTD::CreateDictionary(fs::directory_entry samplesDir) {
 	return false;
 }
 
-void ZSTD::UseDictionary(const uint8_t* dict, size_t len) noexcept {
+void ZSTD::UseDictionary(const uint8_t* dict, size_t len) {
+	if (decompressing) {
+		ZCtx<ZSTD_DDict> digested;
+		if (dict != nullptr) {
+			digested = ZSTD_createDDict_byReference(dict, len);
+			if (!digested)
+				throw std::runtime_error{"Unable to load the ZSTD dictionary"};
+		}
+		dDict = std::move(digested);
+	}
 	dictionary = dict;
 	dictLen		 = len;
 	if (cCtx)
 		ZSTD_CCtx_loadDictionary_byReference(cCtx, dictionary, dictLen);
-	if (dCtx)
-		ZSTD_DCtx_loadDictionary_byReference(dCtx, dictionary, dictLen);
 }
 
 void ZSTD::UseDictionary(std::filesystem::directory_entry ent) {
@@ -221,6 +305,26 @@ void ZSTD::SetStrategyLevel(int level) noexcept {
 	ZSTD_CCtx_setParameter(cCtx, ZSTD_c_strategy, level);
 }
 
+std::string ZSTD::Settings() const {
+	int level = 0, strategy = 0;
+	ZSTD_CCtx_getParameter(cCtx, ZSTD_c_compressionLevel, &level);
+	ZSTD_CCtx_getParameter(cCtx, ZSTD_c_strategy, &strategy);
+	return "zstd "s + ZSTD_versionString() + " level " + std::to_string(level) +
+				 " strategy " + std::to_string(strategy);
+}
+
+std::unique_ptr<ICompress> ZSTD::Clone() const {
+	auto ret = std::make_unique<ZSTD>(compress, dictRatio);
+	for (auto param : {ZSTD_c_compressionLevel, ZSTD_c_strategy}) {
+		int value;
+		if (!ZSTD_isError(ZSTD_CCtx_getParameter(cCtx, param, &value)))
+			ZSTD_CCtx_setParameter(ret->cCtx, param, value);
+	}
+	if (dictionary != nullptr)
+		ret->UseDictionary(dictionary, dictLen);
+	return ret;
+}
+
 int ZSTD::MinCompressLevel() noexcept {
 	return ZSTD_minCLevel();
 }
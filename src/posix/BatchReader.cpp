@@ -0,0 +1,329 @@
+#include "posix/BatchReader.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#	include <linux/io_uring.h>
+#	include <sys/syscall.h>
+#	if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#		define LIBASSETMAP_URING
+#	endif
+#endif
+
+using namespace AssetMap;
+using namespace std::string_literals;
+
+namespace fs = std::filesystem;
+
+//! The most bytes requested by a single read. Larger entries are read in
+//! several, as are those whose reads come up short.
+constexpr size_t maxRead = 1 << 30;
+
+//! An entry being read from the file.
+struct PendingRead {
+	size_t index;
+	MemMappedBucketEntry entry;
+	uint64_t offset;
+	size_t len;
+	size_t done	 = 0;
+	bool reading = false;
+	std::unique_ptr<uint8_t[]> copy;
+	iovec iov{};
+
+	PendingRead(size_t index,
+							MemMappedBucketEntry entry,
+							uint64_t offset,
+							size_t len) noexcept :
+			index{index}, entry{entry}, offset{offset}, len{len} {}
+};
+
+#ifdef LIBASSETMAP_URING
+//! A minimal io_uring driven through raw system calls, so that liburing is
+//! not required.
+struct BatchReader::Ring {
+	io_uring_params params{};
+	FileDescriptor fd;
+	void* sq						= MAP_FAILED;
+	void* cq						= MAP_FAILED;
+	void* sqes					= MAP_FAILED;
+	size_t sqLen				= 0;
+	size_t cqLen				= 0;
+	size_t sqesLen			= 0;
+	unsigned unsubmitted = 0;
+
+	template<typename T>
+	[[nodiscard]] static T* At(void* ring, uint32_t offset) noexcept {
+		return reinterpret_cast<T*>(static_cast<uint8_t*>(ring) + offset);
+	}
+
+	explicit Ring(unsigned depth) :
+			fd{static_cast<int>(syscall(__NR_io_uring_setup, depth, &params))} {
+		if (fd == -1)
+			throw std::runtime_error{"io_uring is unavailable"};
+		sqLen		= params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqLen		= params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		sqesLen = params.sq_entries * sizeof(io_uring_sqe);
+		auto map = [this](size_t len, off_t offset) {
+			return mmap(
+					nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+		};
+		sq	 = map(sqLen, IORING_OFF_SQ_RING);
+		cq	 = map(cqLen, IORING_OFF_CQ_RING);
+		sqes = map(sqesLen, IORING_OFF_SQES);
+		if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+			Unmap();
+			throw std::runtime_error{"Unable to mmap io_uring"};
+		}
+	}
+
+	Ring(const Ring&) = delete;
+
+	//! \return The number of reads that can be in flight at once.
+	[[nodiscard]] unsigned Capacity() const noexcept {
+		return params.sq_entries;
+	}
+
+	//! Queues a read to be submitted by the next call to Enter().
+	void Push(int file, iovec* iov, uint64_t offset, uint64_t user) noexcept {
+		auto* tail = At<unsigned>(sq, params.sq_off.tail);
+		auto idx	 = *tail & *At<unsigned>(sq, params.sq_off.ring_mask);
+		auto& sqe	 = static_cast<io_uring_sqe*>(sqes)[idx];
+		std::memset(&sqe, 0, sizeof(sqe));
+		// Unlike IORING_OP_READ, supported since io_uring was introduced.
+		sqe.opcode		= IORING_OP_READV;
+		sqe.fd				= file;
+		sqe.addr			= reinterpret_cast<uint64_t>(iov);
+		sqe.len				= 1;
+		sqe.off				= offset;
+		sqe.user_data = user;
+		At<unsigned>(sq, params.sq_off.array)[idx] = idx;
+		__atomic_store_n(tail, *tail + 1, __ATOMIC_RELEASE);
+		++unsubmitted;
+	}
+
+	//! Submits queued reads and waits for at least one to complete.
+	//! \return Whether the kernel accepted the reads.
+	[[nodiscard]] bool Enter() noexcept {
+		for (;;) {
+			auto ret = syscall(__NR_io_uring_enter,
+												 static_cast<int>(fd),
+												 unsubmitted,
+												 1u,
+												 IORING_ENTER_GETEVENTS,
+												 nullptr,
+												 0);
+			if (ret >= 0) {
+				unsubmitted -= static_cast<unsigned>(ret);
+				if (unsubmitted == 0)
+					return true;
+			} else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+				return false;
+			}
+		}
+	}
+
+	//! Takes the next completed read, if any.
+	[[nodiscard]] bool Pop(uint64_t& user, int& res) noexcept {
+		auto* head = At<unsigned>(cq, params.cq_off.head);
+		auto tail =
+				__atomic_load_n(At<unsigned>(cq, params.cq_off.tail), __ATOMIC_ACQUIRE);
+		if (*head == tail)
+			return false;
+		auto mask = *At<unsigned>(cq, params.cq_off.ring_mask);
+		auto& cqe = At<io_uring_cqe>(cq, params.cq_off.cqes)[*head & mask];
+		user			= cqe.user_data;
+		res				= cqe.res;
+		__atomic_store_n(head, *head + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	void Unmap() noexcept {
+		if (sq != MAP_FAILED)
+			munmap(sq, sqLen);
+		if (cq != MAP_FAILED)
+			munmap(cq, cqLen);
+		if (sqes != MAP_FAILED)
+			munmap(sqes, sqesLen);
+	}
+
+	~Ring() noexcept {
+		Unmap();
+	}
+};
+#else
+struct BatchReader::Ring {};
+#endif
+
+BatchReader::BatchReader(const MemMappedArchive& archive,
+												 const fs::directory_entry& file,
+												 [[maybe_unused]] unsigned depth,
+												 [[maybe_unused]] bool uring) :
+		archive{archive}, fd{open(file.path().c_str(), O_RDONLY | O_CLOEXEC)} {
+	if (fd == -1)
+		throw std::runtime_error{"Unable to open "s +
+														 file.path().generic_u8string()};
+#ifdef LIBASSETMAP_URING
+	// Kernels without io_uring, or sandboxes forbidding it, fall back to
+	// pread().
+	if (uring) {
+		try {
+			ring = std::make_unique<Ring>(std::clamp(depth, 1u, 4096u));
+		} catch (const std::runtime_error&) {
+		}
+	}
+#endif
+}
+
+bool BatchReader::Uring() const noexcept {
+	return ring != nullptr;
+}
+
+std::vector<BatchResult>
+		BatchReader::Read(const std::vector<BatchRequest>& requests,
+											ThreadPool& pool) {
+	std::vector<BatchResult> results(requests.size());
+	std::vector<PendingRead> reads;
+	reads.reserve(requests.size());
+	for (size_t i = 0; i < requests.size(); ++i) {
+		auto entry			 = archive[requests[i].id];
+		auto [data, len] = entry.Extent();
+		// An alias's data belongs to an earlier entry.
+		uint64_t offset = archive.OffsetOf(entry) - (entry.Address() - data);
+		reads.emplace_back(i, entry, offset, len);
+	}
+	std::sort(reads.begin(), reads.end(), [](auto& lhs, auto& rhs) {
+		return lhs.offset < rhs.offset;
+	});
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	auto remaining = reads.size();
+	auto finish		 = [&] {
+		std::lock_guard lock{mtx};
+		if (--remaining == 0)
+			cv.notify_one();
+	};
+	auto fail = [&](PendingRead& read) {
+		read.copy.reset();
+		results[read.index].error = std::make_exception_ptr(std::runtime_error{
+				"Unable to read " + std::string{read.entry.Name()}});
+		finish();
+	};
+	auto decompress = [&](PendingRead& read) {
+		pool.Submit([&, &read = read](unsigned) {
+			results[read.index] = MemMappedArchive::Retrieve(
+					read.entry.Rebase(read.copy.get()), requests[read.index]);
+			read.copy.reset();
+			finish();
+		});
+	};
+	// Not make_unique: every byte is about to be overwritten.
+	auto allocate = [](PendingRead& read) {
+		read.copy.reset(new (std::nothrow) uint8_t[read.len]);
+		return read.copy != nullptr;
+	};
+	auto readDirect = [&](PendingRead& read) {
+		if (!allocate(read)) {
+			fail(read);
+			return;
+		}
+		while (read.done < read.len) {
+			auto ret = pread(fd,
+											 read.copy.get() + read.done,
+											 std::min(read.len - read.done, maxRead),
+											 read.offset + read.done);
+			if (ret > 0)
+				read.done += ret;
+			else if (ret == 0 || errno != EINTR)
+				break;
+		}
+		if (read.done == read.len)
+			decompress(read);
+		else
+			fail(read);
+	};
+
+	size_t next = 0;
+#ifdef LIBASSETMAP_URING
+	if (ring) {
+		auto issue = [&](size_t i) {
+			auto& read		= reads[i];
+			read.reading	= true;
+			read.iov			= {read.copy.get() + read.done,
+									 std::min(read.len - read.done, maxRead)};
+			ring->Push(fd, &read.iov, read.offset + read.done, i);
+		};
+		unsigned inFlight = 0;
+		while (next < reads.size() || inFlight > 0) {
+			for (; next < reads.size() && inFlight < ring->Capacity(); ++next) {
+				if (!allocate(reads[next])) {
+					fail(reads[next]);
+					continue;
+				}
+				issue(next);
+				++inFlight;
+			}
+			if (inFlight == 0)
+				break;
+			if (!ring->Enter()) {
+				// The kernel may still write to the buffers of reads in flight, so
+				// they are leaked rather than freed and the reads start over in new
+				// buffers with pread(), as do those not yet issued.
+				ring.reset();
+				for (auto& read : reads) {
+					if (read.reading) {
+						read.copy.release();
+						read.done		 = 0;
+						read.reading = false;
+						readDirect(read);
+					}
+				}
+				break;
+			}
+			uint64_t i;
+			int res;
+			while (ring->Pop(i, res)) {
+				auto& read = reads[i];
+				if (res == -EINTR || res == -EAGAIN) {
+					issue(i);
+					continue;
+				}
+				if (res > 0)
+					read.done += res;
+				if (res > 0 && read.done < read.len) {
+					issue(i);
+					continue;
+				}
+				read.reading = false;
+				--inFlight;
+				if (read.done == read.len)
+					decompress(read);
+				else
+					fail(read);
+			}
+		}
+	}
+#endif
+	for (; next < reads.size(); ++next)
+		readDirect(reads[next]);
+
+	std::unique_lock lock{mtx};
+	cv.wait(lock, [&remaining] { return remaining == 0; });
+	return results;
+}
+
+BatchReader::~BatchReader() noexcept = default;
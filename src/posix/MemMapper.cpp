@@ -1,11 +1,16 @@
 #include "posix/MemMapper.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
+#ifndef MAP_POPULATE
+#	define MAP_POPULATE 0
+#endif
+
 using namespace AssetMap;
 using namespace std::string_literals;
 
@@ -25,6 +30,15 @@ namespace fs = std::filesystem;
 	return fd;
 }
 
+//! Opens a file for reading without ever creating it.
+[[nodiscard]] static int OpenExisting(const fs::directory_entry& file) {
+	int fd = open(file.path().c_str(), O_RDONLY);
+	if (fd == -1)
+		throw std::runtime_error{"Unable to open "s +
+														 file.path().generic_u8string()};
+	return fd;
+}
+
 FileDescriptor::FileDescriptor(int fd) : fd{fd} {}
 
 FileDescriptor::FileDescriptor(FileDescriptor&& rhs) noexcept : fd{rhs.fd} {
@@ -58,8 +72,36 @@ MemMapper::MemMapper(const fs::directory_entry& file) :
 															 file.path().generic_u8string()};
 }
 
+MemMapper::MemMapper(const fs::directory_entry& file,
+										 const MapOptions& options) :
+		fd{OpenExisting(file)}, len{file.file_size()} {
+	if (len == 0)
+		throw std::runtime_error{"Unable to mmap empty file "s +
+														 file.path().generic_u8string()};
+	auto start = std::chrono::steady_clock::now();
+	auto flags = MAP_PRIVATE | MAP_NORESERVE;
+	// Huge page advice has to be given before the file is read in.
+	if (options.populate && !options.hugePages)
+		flags |= MAP_POPULATE;
+	if (mMap = mmap(nullptr, len, PROT_READ, flags, fd, 0); mMap == MAP_FAILED)
+		throw std::runtime_error{"Unable to mmap "s +
+														 file.path().generic_u8string()};
+#ifdef MADV_HUGEPAGE
+	if (options.hugePages)
+		stats.hugePages = madvise(mMap, len, MADV_HUGEPAGE) == 0;
+#endif
+	if (options.populate) {
+		if (!(flags & MAP_POPULATE))
+			Populate();
+		stats.populated = true;
+	}
+	if (options.lock)
+		stats.locked = Lock(0, len);
+	stats.openTime = std::chrono::steady_clock::now() - start;
+}
+
 MemMapper::MemMapper(MemMapper&& rhs) noexcept :
-		fd{std::move(rhs.fd)}, len{rhs.len}, mMap{rhs.mMap} {
+		fd{std::move(rhs.fd)}, len{rhs.len}, mMap{rhs.mMap}, stats{rhs.stats} {
 	rhs.mMap = MAP_FAILED;
 }
 
@@ -68,6 +110,7 @@ MemMapper& MemMapper::operator=(MemMapper&& rhs) noexcept {
 	fd			 = std::move(rhs.fd);
 	len			 = rhs.len;
 	mMap		 = rhs.mMap;
+	stats		 = rhs.stats;
 	rhs.mMap = MAP_FAILED;
 	return *this;
 }
@@ -103,6 +146,50 @@ uint8_t* MemMapper::Get() noexcept {
 	return static_cast<uint8_t*>(mMap);
 }
 
+void MemMapper::Populate() noexcept {
+#ifdef MADV_POPULATE_READ
+	if (madvise(mMap, len, MADV_POPULATE_READ) == 0)
+		return;
+#endif
+	// Fault every page in by reading a byte of it.
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	auto* data			= static_cast<const volatile uint8_t*>(mMap);
+	for (size_t i = 0; i < len; i += pageSize)
+		(void)data[i];
+}
+
+bool MemMapper::Lock(size_t offset, size_t len) noexcept {
+	if (mMap == MAP_FAILED || mMap == nullptr || offset >= this->len)
+		return false;
+	len				 = std::min<size_t>(len, this->len - offset);
+	auto start = offset - offset % sysconf(_SC_PAGESIZE);
+	return mlock(Get() + start, len + (offset - start)) == 0;
+}
+
+const MapStats& MemMapper::Stats() const noexcept {
+	return stats;
+}
+
+void MemMapper::Advise(Access access) noexcept {
+	if (mMap == MAP_FAILED || mMap == nullptr)
+		return;
+	int advice = MADV_NORMAL;
+	if (access == Access::Random)
+		advice = MADV_RANDOM;
+	else if (access == Access::Sequential)
+		advice = MADV_SEQUENTIAL;
+	madvise(mMap, len, advice);
+}
+
+void MemMapper::WillNeed(size_t offset, size_t len) noexcept {
+	if (mMap == MAP_FAILED || mMap == nullptr || offset >= this->len)
+		return;
+	len = std::min<size_t>(len, this->len - offset);
+	// madvise() requires a page-aligned address.
+	auto start = offset - offset % sysconf(_SC_PAGESIZE);
+	madvise(Get() + start, len + (offset - start), MADV_WILLNEED);
+}
+
 void MemMapper::Close() noexcept {
 	if (mMap != MAP_FAILED)
 		munmap(mMap, len);
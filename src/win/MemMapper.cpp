@@ -1,5 +1,6 @@
 #include "win/MemMapper.h"
 
+#include <algorithm>
 #include <cassert>
 
 #define WIN32_LEAN_AND_MEAN
@@ -10,24 +11,30 @@ using namespace std::string_literals;
 
 namespace fs = std::filesystem;
 
+[[nodiscard]] static void* OpenExisting(const fs::directory_entry& file) {
+	void* fd = CreateFileW(file.path().c_str(),
+												 GENERIC_READ,
+												 FILE_SHARE_READ,
+												 nullptr,
+												 OPEN_EXISTING,
+												 FILE_ATTRIBUTE_NORMAL,
+												 nullptr);
+	if (fd == INVALID_HANDLE_VALUE)
+		throw std::runtime_error{"Unable to open "s +
+														 file.path().generic_u8string()};
+	return fd;
+}
+
 [[nodiscard]] static void* OpenFile(const fs::directory_entry& file) {
-	void* fd;
 	if (file.exists())
-		fd = CreateFileW(file.path().c_str(),
-										 GENERIC_READ,
-										 FILE_SHARE_READ,
-										 nullptr,
-										 OPEN_EXISTING,
-										 FILE_ATTRIBUTE_NORMAL,
-										 nullptr);
-	else
-		fd = CreateFileW(file.path().c_str(),
-										 GENERIC_READ | GENERIC_WRITE,
-										 FILE_SHARE_READ,
-										 nullptr,
-										 CREATE_NEW,
-										 FILE_ATTRIBUTE_NORMAL,
-										 nullptr);
+		return OpenExisting(file);
+	void* fd = CreateFileW(file.path().c_str(),
+												 GENERIC_READ | GENERIC_WRITE,
+												 FILE_SHARE_READ,
+												 nullptr,
+												 CREATE_NEW,
+												 FILE_ATTRIBUTE_NORMAL,
+												 nullptr);
 	if (fd == INVALID_HANDLE_VALUE)
 		throw std::runtime_error{"Unable to open "s +
 														 file.path().generic_u8string()};
@@ -59,6 +66,10 @@ FileDescriptor::~FileDescriptor() noexcept {
 
 MemMapper::MemMapper(const fs::directory_entry& file) :
 		fd{OpenFile(file)}, len{file.exists() ? file.file_size() : 0} {
+	Map(file);
+}
+
+void MemMapper::Map(const fs::directory_entry& file) {
 	if (len > 0) {
 		if (fMap = CreateFileMappingW(fd, nullptr, PAGE_READONLY, 0, 0, nullptr);
 				fMap == nullptr)
@@ -76,8 +87,35 @@ MemMapper::MemMapper(const fs::directory_entry& file) :
 	}
 }
 
+MemMapper::MemMapper(const fs::directory_entry& file,
+										 const MapOptions& options) :
+		fd{OpenExisting(file)}, len{file.file_size()} {
+	if (len == 0)
+		throw std::runtime_error{"Unable to mmap empty file "s +
+														 file.path().generic_u8string()};
+	auto start = std::chrono::steady_clock::now();
+	Map(file);
+	// Huge pages are only available for anonymous memory on Windows.
+	if (options.populate) {
+		WillNeed(0, len);
+		auto* data = static_cast<const volatile uint8_t*>(mMap);
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		for (size_t i = 0; i < len; i += info.dwPageSize)
+			(void)data[i];
+		stats.populated = true;
+	}
+	if (options.lock)
+		stats.locked = Lock(0, len);
+	stats.openTime = std::chrono::steady_clock::now() - start;
+}
+
 MemMapper::MemMapper(MemMapper&& rhs) noexcept :
-		fd{std::move(rhs.fd)}, len{rhs.len}, fMap{rhs.fMap}, mMap{rhs.mMap} {
+		fd{std::move(rhs.fd)},
+		len{rhs.len},
+		fMap{rhs.fMap},
+		mMap{rhs.mMap},
+		stats{rhs.stats} {
 	rhs.fMap = nullptr;
 	rhs.mMap = nullptr;
 }
@@ -88,6 +126,7 @@ MemMapper& MemMapper::operator=(MemMapper&& rhs) noexcept {
 	len			 = rhs.len;
 	fMap		 = rhs.fMap;
 	mMap		 = rhs.mMap;
+	stats		 = rhs.stats;
 	rhs.fMap = nullptr;
 	rhs.mMap = nullptr;
 	return *this;
@@ -136,6 +175,45 @@ uint8_t* MemMapper::Get() noexcept {
 	return static_cast<uint8_t*>(mMap);
 }
 
+//! Mirrors WIN32_MEMORY_RANGE_ENTRY, which is only declared when targeting
+//! Windows 8 or later.
+struct MemoryRange {
+	void* VirtualAddress;
+	SIZE_T NumberOfBytes;
+};
+
+using PrefetchFn = BOOL(WINAPI*)(HANDLE, ULONG_PTR, MemoryRange*, ULONG);
+
+//! PrefetchVirtualMemory() was introduced in Windows 8, so it is looked up at
+//! runtime rather than preventing the library from loading on older versions.
+[[nodiscard]] static PrefetchFn LoadPrefetch() noexcept {
+	auto* kernel = GetModuleHandleW(L"kernel32.dll");
+	if (kernel == nullptr)
+		return nullptr;
+	return reinterpret_cast<PrefetchFn>(
+			reinterpret_cast<void*>(GetProcAddress(kernel, "PrefetchVirtualMemory")));
+}
+
+void MemMapper::WillNeed(size_t offset, size_t len) noexcept {
+	static const auto prefetch = LoadPrefetch();
+	if (prefetch == nullptr || mMap == nullptr || offset >= this->len)
+		return;
+	MemoryRange range;
+	range.VirtualAddress = Get() + offset;
+	range.NumberOfBytes	 = std::min<size_t>(len, this->len - offset);
+	prefetch(GetCurrentProcess(), 1, &range, 0);
+}
+
+bool MemMapper::Lock(size_t offset, size_t len) noexcept {
+	if (mMap == nullptr || offset >= this->len)
+		return false;
+	return VirtualLock(Get() + offset, std::min<size_t>(len, this->len - offset));
+}
+
+const MapStats& MemMapper::Stats() const noexcept {
+	return stats;
+}
+
 void MemMapper::Close() noexcept {
 	if (mMap != nullptr)
 		UnmapViewOfFile(mMap);
@@ -1,16 +1,40 @@
 #include <catch.hpp>
 
+#include "ArchiveWriters.h"
+#include "AssetCache.h"
+#include "AssetHeader.h"
+#include "AsyncLoader.h"
+#ifndef _WIN32
+#	include "BatchReader.h"
+#endif
+#include "DirectoryMetadata.h"
+#include "EntryFormat.h"
 #include "Hashers.h"
 #include "MemMappedArchive.h"
 #include "MemMapper.h"
+#include "NameTable.h"
+#include "ReadMapper.h"
+#include "StaticCityHash.h"
+#include "ThreadPool.h"
 #include "ZSTDComp.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <random>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 using namespace AssetMap;
 using namespace std::string_literals;
@@ -35,6 +59,46 @@ public:
 	}
 };
 
+//! An archive built from a directory into a file of its own, which is removed
+//! once the archive is closed. Used to compare builds with different options.
+class BuiltArchive {
+	struct File {
+		fs::path path;
+
+		~File() {
+			fs::remove(path);
+		}
+	} file;
+
+	static fs::path Build(std::string_view name,
+												const fs::path& dir,
+												const IHasher& hash,
+												ICompress& comp,
+												const BuildOptions& options) {
+		auto path = fs::current_path() / ("testme-"s + std::string{name} + ".lam");
+		StreamWriter out{path};
+		MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp, options);
+		return path;
+	}
+
+public:
+	MemMapper in;
+	MemMappedArchive archive;
+
+	[[nodiscard]] const fs::path& Path() const noexcept {
+		return file.path;
+	}
+
+	BuiltArchive(std::string_view name,
+							 const fs::path& dir,
+							 const IHasher& hash,
+							 ZSTD& comp,
+							 const BuildOptions& options = {}) :
+			file{Build(name, dir, hash, comp, options)},
+			in{fs::directory_entry{file.path}},
+			archive{in, comp, hash} {}
+};
+
 SCENARIO_METHOD(FSCleanup,
 								"An archive can be successfully compressed and decompressed") {
 	GIVEN("A Directory with some random files in it") {
@@ -235,3 +299,1473 @@ SCENARIO_METHOD(FSCleanup,
 		}
 	}
 }
+
+SCENARIO_METHOD(FSCleanup,
+								"A multi-threaded build is identical to a single-threaded one") {
+	GIVEN("A directory hierarchy with a mix of compressible and random data") {
+		std::minstd_rand rng;
+		rng.seed(std::random_device{}());
+		fs::create_directories(dir / "sub" / "deeper");
+		for (auto i = 0; i < 64; ++i) {
+			auto sub	= i % 3 == 0 ? fs::path{"sub"} : fs::path{"sub/deeper"};
+			auto file = dir / sub / ("file"s + std::to_string(i) + ".bin");
+			std::ofstream f{file, std::ios::binary};
+			for (auto j = 0; j < i * 50; ++j)
+				f << (j % 2 ? "common text" : std::to_string(rng()));
+		}
+		CityHash hash;
+		auto parallelArc = fs::current_path() / "testme-parallel.lam";
+		fs::remove(parallelArc);
+		WHEN("We build it serially and with several threads") {
+			{
+				ZSTD comp{ZSTD::compress};
+				comp.SetCompressLevel(5);
+				MemMapper serial{fs::directory_entry{arc}};
+				MemMappedArchive{fs::directory_entry{dir}, hash, serial, comp};
+				BuildOptions options;
+				options.threads = 4;
+				MemMapper parallel{fs::directory_entry{parallelArc}};
+				MemMappedArchive{
+						fs::directory_entry{dir}, hash, parallel, comp, nullptr, options};
+			}
+			THEN("Both archives should be byte-identical") {
+				MemMapper serial{fs::directory_entry{arc}};
+				MemMapper parallel{fs::directory_entry{parallelArc}};
+				REQUIRE(serial.Size() == parallel.Size());
+				REQUIRE(ToSV(serial.Get(), serial.Size()) ==
+								ToSV(parallel.Get(), parallel.Size()));
+			}
+			AND_THEN("The parallel archive should be readable") {
+				ZSTD comp{ZSTD::decompress};
+				MemMapper in{fs::directory_entry{parallelArc}};
+				MemMappedArchive archive{in, comp, hash};
+				for (auto& file : fs::recursive_directory_iterator{dir}) {
+					if (!file.is_regular_file())
+						continue;
+					auto name = fs::relative(file, dir).generic_u8string();
+					auto item = archive[name];
+					REQUIRE(item);
+					auto&& [ptr, len] = item.Retrieve();
+					REQUIRE(len == file.file_size());
+					if (len == 0)
+						continue;
+					MemMapper onDisk{file};
+					REQUIRE(ToSV(ptr.get(), len) == ToSV(onDisk.Get(), onDisk.Size()));
+				}
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup,
+								"An archive can be streamed straight to disk at its exact size") {
+	GIVEN("A Directory with some random files in it") {
+		auto data1 = "This is a test string"sv;
+		auto data2 = "This is \xBD binary"sv;
+		std::ofstream{dir / "file1.txt"} << data1;
+		std::ofstream{dir / "file2.txt", std::ios::binary} << data2;
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		auto mappedArc = fs::current_path() / "testme-mapped.lam";
+		fs::remove(mappedArc);
+		WHEN("We stream it into an archive and also build it through a mapping") {
+			{
+				StreamWriter out{arc};
+				MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp);
+				MemMapper mapped{fs::directory_entry{mappedArc}};
+				MemMappedArchive{fs::directory_entry{dir}, hash, mapped, comp};
+			}
+			THEN("Both archives should be byte-identical") {
+				MemMapper streamed{fs::directory_entry{arc}};
+				MemMapper mapped{fs::directory_entry{mappedArc}};
+				REQUIRE(streamed.Size() == mapped.Size());
+				REQUIRE(ToSV(streamed.Get(), streamed.Size()) ==
+								ToSV(mapped.Get(), mapped.Size()));
+			}
+			AND_THEN("The streamed archive should be readable") {
+				MemMapper in{fs::directory_entry{arc}};
+				MemMappedArchive archive{in, comp, hash};
+				auto&& [ptr, len] = archive["file2.txt"].Retrieve();
+				REQUIRE(ToSV(ptr.get(), len) == data2);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "A directory can be scanned with several threads") {
+	GIVEN("A nested directory hierarchy") {
+		for (auto i = 0; i < 20; ++i) {
+			auto sub = dir / ("dir"s + std::to_string(i % 5)) / std::to_string(i);
+			fs::create_directories(sub);
+			std::ofstream{sub / "a.txt"} << i;
+			std::ofstream{sub / "b.txt"} << i * 2;
+		}
+		CityHash hash{0.5};
+		ZSTD comp{ZSTD::compress};
+		WHEN("We scan it serially and in parallel") {
+			DirectoryMetadata serial{hash, comp, fs::directory_entry{dir}};
+			DirectoryMetadata parallel{hash, comp, fs::directory_entry{dir}, 4};
+			THEN("Both should produce the same buckets in the same order") {
+				REQUIRE(serial.TotalRequiredSpace() == parallel.TotalRequiredSpace());
+				REQUIRE(serial.Buckets() == parallel.Buckets());
+				size_t total = 0;
+				for (auto& bucket : parallel.Buckets())
+					total += bucket.size();
+				REQUIRE(total == 40);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup,
+								"An archive can be rebuilt incrementally from a previous one") {
+	GIVEN("An archive built with a manifest") {
+		std::ofstream{dir / "same.txt"} << "unchanged contents";
+		std::ofstream{dir / "touched.txt"} << "touched contents";
+		std::ofstream{dir / "changed.txt"} << "old contents";
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		BuildOptions options;
+		options.manifest = true;
+		{
+			StreamWriter out{arc};
+			MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp, options);
+		}
+		auto sameTime = fs::last_write_time(dir / "same.txt");
+		// Same size and modification time, so it must be taken from the old
+		// archive without being read.
+		std::ofstream{dir / "same.txt"} << "UNCHANGED CONTENTS";
+		fs::last_write_time(dir / "same.txt", sameTime);
+		// Same content with a new modification time; verified by hash.
+		fs::last_write_time(dir / "touched.txt",
+												sameTime + std::chrono::seconds{10});
+		std::ofstream{dir / "changed.txt"} << "new and longer contents";
+		std::ofstream{dir / "added.txt"} << "added contents";
+		auto newArc = fs::current_path() / "testme-incremental.lam";
+		fs::remove(newArc);
+		WHEN("We rebuild it incrementally") {
+			{
+				MemMapper in{fs::directory_entry{arc}};
+				MemMappedArchive previous{in, comp, hash};
+				BuildOptions incremental;
+				incremental.previous = &previous;
+				StreamWriter out{newArc};
+				MemMappedArchive::Build(
+						fs::directory_entry{dir}, hash, out, comp, incremental);
+			}
+			THEN("Unchanged files are reused and changed files are recompressed") {
+				MemMapper in{fs::directory_entry{newArc}};
+				MemMappedArchive archive{in, comp, hash};
+				REQUIRE(archive.Section(SectionId::Manifest).first != nullptr);
+				auto read = [&](std::string_view name) {
+					auto&& [ptr, len] = archive[name].Retrieve();
+					return std::string{ToSV(ptr.get(), len)};
+				};
+				REQUIRE(read("same.txt") == "unchanged contents");
+				REQUIRE(read("touched.txt") == "touched contents");
+				REQUIRE(read("changed.txt") == "new and longer contents");
+				REQUIRE(read("added.txt") == "added contents");
+			}
+		}
+		WHEN("We rebuild it with different compression settings") {
+			MemMapper in{fs::directory_entry{arc}};
+			MemMappedArchive previous{in, comp, hash};
+			ZSTD other{ZSTD::compress};
+			other.SetCompressLevel(ZSTD::MaxCompressLevel());
+			BuildOptions incremental;
+			incremental.previous = &previous;
+			THEN("The build is refused") {
+				StreamWriter out{newArc};
+				REQUIRE_THROWS_AS(
+						MemMappedArchive::Build(
+								fs::directory_entry{dir}, hash, out, other, incremental),
+						std::runtime_error);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Files with identical contents are stored once") {
+	GIVEN("A Directory with several copies of the same file") {
+		std::string shared(4096, '\0');
+		std::mt19937 rng{42};
+		for (auto& c : shared)
+			c = static_cast<char>(rng());
+		for (auto i = 0; i < 4; ++i)
+			std::ofstream{dir / ("copy"s + std::to_string(i) + ".bin"),
+										std::ios::binary}
+					<< shared;
+		std::ofstream{dir / "unique.txt"} << "something else";
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		auto dedupArc = fs::current_path() / "testme-dedup.lam";
+		fs::remove(dedupArc);
+		WHEN("We build it with and without deduplication") {
+			BuildOptions options;
+			options.deduplicate = true;
+			{
+				StreamWriter plain{arc};
+				MemMappedArchive::Build(fs::directory_entry{dir}, hash, plain, comp);
+				StreamWriter dedup{dedupArc};
+				MemMappedArchive::Build(
+						fs::directory_entry{dir}, hash, dedup, comp, options);
+			}
+			THEN("The deduplicated archive is smaller and shares the data") {
+				REQUIRE(fs::file_size(dedupArc) + 3 * 4000 < fs::file_size(arc));
+				MemMapper in{fs::directory_entry{dedupArc}};
+				MemMappedArchive archive{in, comp, hash};
+				REQUIRE(archive.Features() != 0);
+				auto first = archive["copy0.bin"].Compressed();
+				size_t aliases = 0;
+				for (auto i = 0; i < 4; ++i) {
+					auto entry = archive["copy"s + std::to_string(i) + ".bin"];
+					REQUIRE(entry.Compressed() == first);
+					aliases += entry.Flags() & entryAlias ? 1 : 0;
+					auto&& [ptr, len] = entry.Retrieve();
+					REQUIRE(ToSV(ptr.get(), len) == shared);
+				}
+				REQUIRE(aliases == 3);
+				auto&& [ptr, len] = archive["unique.txt"].Retrieve();
+				REQUIRE(ToSV(ptr.get(), len) == "something else");
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Incompressible files can be stored as-is") {
+	GIVEN("A Directory with a random file and a repetitive one") {
+		std::string noise(4096, '\0');
+		std::mt19937 rng{7};
+		for (auto& c : noise)
+			c = static_cast<char>(rng());
+		std::string text(4096, 'a');
+		std::ofstream{dir / "noise.bin", std::ios::binary} << noise;
+		std::ofstream{dir / "text.txt"} << text;
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		WHEN("We build it with storing enabled") {
+			BuildOptions options;
+			options.store = true;
+			{
+				StreamWriter out{arc};
+				MemMappedArchive::Build(
+						fs::directory_entry{dir}, hash, out, comp, options);
+			}
+			MemMapper in{fs::directory_entry{arc}};
+			MemMappedArchive archive{in, comp, hash};
+			THEN("The random file is readable in place from the archive") {
+				auto entry			= archive["noise.bin"];
+				auto [ptr, len] = entry.Stored();
+				REQUIRE(entry.Flags() & entryStored);
+				REQUIRE(ptr >= in.Get());
+				REQUIRE(ptr + len <= in.Get() + in.Size());
+				REQUIRE(ToSV(ptr, len) == noise);
+				REQUIRE(entry.DecompressedSize() == noise.size());
+				auto&& [buf, bufLen] = entry.Retrieve();
+				REQUIRE(ToSV(buf.get(), bufLen) == noise);
+			}
+			AND_THEN("The repetitive file is still compressed") {
+				auto entry = archive["text.txt"];
+				REQUIRE(entry.Stored().first == nullptr);
+				REQUIRE(entry.FileSize() < text.size());
+				auto&& [buf, len] = entry.Retrieve();
+				REQUIRE(ToSV(buf.get(), len) == text);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Names can be looked up through a perfect hash") {
+	GIVEN("A Directory with many files in few buckets") {
+		for (auto i = 0; i < 300; ++i)
+			std::ofstream{dir / ("file"s + std::to_string(i) + ".txt")} << i;
+		// Overload the buckets so that a bucket walk would be long.
+		CityHash hash{20.f};
+		ZSTD comp{ZSTD::both};
+		WHEN("We build it with a perfect hash") {
+			BuildOptions options;
+			options.perfectHash = true;
+			{
+				StreamWriter out{arc};
+				MemMappedArchive::Build(
+						fs::directory_entry{dir}, hash, out, comp, options);
+			}
+			MemMapper in{fs::directory_entry{arc}};
+			MemMappedArchive archive{in, comp, hash};
+			THEN("Every name is found at the same entry as through its bucket") {
+				REQUIRE(archive.Section(SectionId::PerfectHash).first != nullptr);
+				for (auto i = 0; i < 300; ++i) {
+					auto name	 = "file"s + std::to_string(i) + ".txt";
+					auto entry = archive[name];
+					REQUIRE(entry);
+					REQUIRE(entry.Name() == name);
+					auto bucket = hash.CalcBucket(hash.Hash(name), archive.BucketCount());
+					REQUIRE(entry == archive[bucket][name]);
+					auto&& [ptr, len] = entry.Retrieve();
+					REQUIRE(ToSV(ptr.get(), len) == std::to_string(i));
+				}
+			}
+			AND_THEN("Names that are not in the archive are not found") {
+				REQUIRE_FALSE(archive["missing.txt"]);
+				REQUIRE_FALSE(archive["file300.txt"]);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Entries can be loaded through generated asset IDs") {
+	GIVEN("An archive built with a fingerprint") {
+		fs::create_directory(dir / "sub");
+		std::ofstream{dir / "sub" / "file.txt"} << "nested";
+		std::ofstream{dir / "1st-file.txt"} << "first";
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		BuildOptions options;
+		options.fingerprint = true;
+		{
+			StreamWriter out{arc};
+			MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp, options);
+		}
+		MemMapper in{fs::directory_entry{arc}};
+		MemMappedArchive archive{in, comp, hash};
+		WHEN("We generate a header for it") {
+			std::ostringstream header;
+			WriteAssetHeader(archive, header, "Assets");
+			THEN("It declares the fingerprint and one ID per entry") {
+				auto text		= header.str();
+				auto offset = archive.OffsetOf(archive["sub/file.txt"]);
+				REQUIRE(text.find("namespace Assets {") != std::string::npos);
+				REQUIRE(text.find("constexpr AssetMap::AssetId SUB_FILE_TXT{" +
+													std::to_string(offset) + "};") !=
+								std::string::npos);
+				REQUIRE(text.find("ASSET_1ST_FILE_TXT{") != std::string::npos);
+			}
+		}
+		WHEN("We load an entry by its ID") {
+			AssetId id{archive.OffsetOf(archive["sub/file.txt"])};
+			auto&& [ptr, len] = archive[id].Retrieve();
+			THEN("We get the same entry as when looking it up by name") {
+				REQUIRE(archive[id] == archive["sub/file.txt"]);
+				REQUIRE(ToSV(ptr.get(), len) == "nested");
+			}
+		}
+		THEN("Only the archive's own fingerprint is accepted") {
+			REQUIRE(archive.Fingerprint());
+			REQUIRE_NOTHROW(archive.RequireFingerprint(*archive.Fingerprint()));
+			REQUIRE_THROWS_AS(archive.RequireFingerprint(*archive.Fingerprint() + 1),
+												std::runtime_error);
+		}
+		AND_WHEN("A file is added to the directory and the archive rebuilt") {
+			auto fingerprint = *archive.Fingerprint();
+			std::ofstream{dir / "added.txt"} << "added";
+			auto newArc = fs::current_path() / "testme-fingerprint.lam";
+			{
+				StreamWriter out{newArc};
+				MemMappedArchive::Build(
+						fs::directory_entry{dir}, hash, out, comp, options);
+			}
+			MemMapper newIn{fs::directory_entry{newArc}};
+			MemMappedArchive rebuilt{newIn, comp, hash};
+			THEN("The old IDs are rejected") {
+				REQUIRE_THROWS_AS(rebuilt.RequireFingerprint(fingerprint),
+													std::runtime_error);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Generated headers are valid whatever the names") {
+	GIVEN("Names that do not map directly onto identifiers") {
+		THEN("Identifiers are never reserved") {
+			REQUIRE(AssetIdentifier("_hidden.txt") == "ASSET_HIDDEN_TXT");
+			REQUIRE(AssetIdentifier("a__b--c.txt") == "A_B_C_TXT");
+			REQUIRE(AssetIdentifier("1st.txt") == "ASSET_1ST_TXT");
+			REQUIRE(AssetIdentifier("") == "ASSET");
+		}
+	}
+	GIVEN("An archive whose names could break the comments documenting them") {
+		std::ofstream{dir / "a_b"} << "1";
+		std::ofstream{dir / "a-b"} << "2";
+		std::ofstream{dir / "quote\"name"} << "3";
+#ifndef _WIN32
+		std::ofstream{dir / "trailing\\"} << "4";
+		// Split so that the test itself does not contain a trigraph.
+		fs::create_directory(dir / "what?" "?");
+		std::ofstream{dir / "what?" "?" / "x"} << "5";
+#endif
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		BuildOptions options;
+		options.fingerprint = true;
+		{
+			StreamWriter out{arc};
+			MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp, options);
+		}
+		MemMapper in{fs::directory_entry{arc}};
+		MemMappedArchive archive{in, comp, hash};
+		WHEN("We generate a header for it") {
+			std::ostringstream header;
+			WriteAssetHeader(archive, header, "Assets");
+			auto text = header.str();
+			THEN("No line is spliced onto the next and no trigraph is formed") {
+				REQUIRE(text.find("\\\n") == std::string::npos);
+				REQUIRE(text.find("??") == std::string::npos);
+				REQUIRE(text.find("//! \"quote\\\"name\"\n") != std::string::npos);
+#ifndef _WIN32
+				REQUIRE(text.find("//! \"trailing\\\\\"\n") != std::string::npos);
+				REQUIRE(text.find("//! \"what?\\?/x\"\n") != std::string::npos);
+#endif
+			}
+			THEN("Colliding identifiers are told apart without a double underscore") {
+				REQUIRE(text.find(" A_B{") != std::string::npos);
+				REQUIRE(text.find(" A_B_2{") != std::string::npos);
+				REQUIRE(text.find("__") == std::string::npos);
+			}
+		}
+	}
+}
+
+SCENARIO("CityHash can be computed at compile time") {
+	GIVEN("Strings of every length up to a few blocks") {
+		std::string data;
+		CityHash hash;
+		THEN("The constexpr hash matches CityHash for each of them") {
+			for (auto i = 0; i < 300; ++i) {
+				REQUIRE(StaticCityHash(data) == hash.Hash(data));
+				data.push_back(static_cast<char>(i * 37 + 11));
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Entries can be found by precomputed hash or handle") {
+	GIVEN("An archive with a few files") {
+		using namespace AssetMap::Literals;
+		std::ofstream{dir / "file1.txt"} << "one";
+		std::ofstream{dir / "file2.txt"} << "two";
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		{
+			StreamWriter out{arc};
+			MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp);
+		}
+		MemMapper in{fs::directory_entry{arc}};
+		MemMappedArchive archive{in, comp, hash};
+		WHEN("We look up a file with a hash computed at compile time") {
+			constexpr auto fileHash = "file2.txt"_cityhash;
+			auto entry							= archive.Find("file2.txt", fileHash);
+			THEN("We get the same entry as by name") {
+				REQUIRE(entry == archive["file2.txt"]);
+			}
+		}
+		WHEN("We resolve names into handles") {
+			auto id			 = archive.Resolve("file1.txt");
+			auto missing = archive.Resolve("missing.txt");
+			THEN("Existing files can be retrieved through their handles") {
+				REQUIRE(id);
+				REQUIRE_FALSE(missing);
+				for (auto i = 0; i < 3; ++i) {
+					auto&& [ptr, len] = archive[*id].Retrieve();
+					REQUIRE(ToSV(ptr.get(), len) == "one");
+				}
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Buckets can carry a tag per entry") {
+	GIVEN("A Directory with many files in few buckets") {
+		for (auto i = 0; i < 200; ++i)
+			std::ofstream{dir / ("file"s + std::to_string(i) + ".txt")} << i;
+		CityHash hash{40.f};
+		ZSTD comp{ZSTD::both};
+		WHEN("We build it with and without tags") {
+			BuildOptions options;
+			options.bucketTags = true;
+			BuiltArchive tagged{"tagged", dir, hash, comp, options};
+			BuiltArchive untagged{"untagged", dir, hash, comp};
+			auto& archive = tagged.archive;
+			auto& plain		= untagged.archive;
+			THEN("Every file is found and iteration yields the same names") {
+				REQUIRE(archive.Features() & featureBucketTags);
+				for (auto i = 0; i < 200; ++i) {
+					auto name	 = "file"s + std::to_string(i) + ".txt";
+					auto entry = archive[name];
+					REQUIRE(entry);
+					REQUIRE(entry.Name() == name);
+					auto&& [ptr, len] = entry.Retrieve();
+					REQUIRE(ToSV(ptr.get(), len) == std::to_string(i));
+				}
+				REQUIRE_FALSE(archive["missing.txt"]);
+				for (lam_size_t id = 0; id < archive.BucketCount(); ++id) {
+					std::vector<std::string_view> names, plainNames;
+					for (auto&& entry : archive[id])
+						names.push_back(entry.Name());
+					for (auto&& entry : plain[id])
+						plainNames.push_back(entry.Name());
+					REQUIRE(names == plainNames);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Names can be looked up through a separate index") {
+	GIVEN("A Directory with many files in few buckets") {
+		for (auto i = 0; i < 200; ++i)
+			std::ofstream{dir / ("file"s + std::to_string(i) + ".txt")} << i;
+		CityHash hash{10.f};
+		ZSTD comp{ZSTD::both};
+		WHEN("We build it with a lookup index") {
+			BuildOptions options;
+			options.lookupIndex = true;
+			{
+				StreamWriter out{arc};
+				MemMappedArchive::Build(
+						fs::directory_entry{dir}, hash, out, comp, options);
+			}
+			MemMapper in{fs::directory_entry{arc}};
+			MemMappedArchive archive{in, comp, hash};
+			THEN("Every name is found at the same entry as through its bucket") {
+				REQUIRE(archive.Section(SectionId::LookupIndex).first != nullptr);
+				for (auto i = 0; i < 200; ++i) {
+					auto name	 = "file"s + std::to_string(i) + ".txt";
+					auto entry = archive[name];
+					REQUIRE(entry);
+					auto bucket = hash.CalcBucket(hash.Hash(name), archive.BucketCount());
+					REQUIRE(entry == archive[bucket][name]);
+					auto&& [ptr, len] = entry.Retrieve();
+					REQUIRE(ToSV(ptr.get(), len) == std::to_string(i));
+				}
+				REQUIRE_FALSE(archive["missing.txt"]);
+				REQUIRE_FALSE(archive["file20"]);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Names can be stored front-coded") {
+	GIVEN("A deep directory hierarchy") {
+		std::vector<std::string> expected;
+		for (auto i = 0; i < 100; ++i) {
+			auto sub = "textures/environment/forest/"s + std::to_string(i % 7);
+			fs::create_directories(dir / sub);
+			auto name = sub + "/tree" + std::to_string(i) + ".png";
+			std::ofstream{dir / name} << i;
+			expected.push_back(name);
+		}
+		std::sort(expected.begin(), expected.end());
+		CityHash hash{8.f};
+		ZSTD comp{ZSTD::both};
+		WHEN("We build it with a lookup index with and without a name table") {
+			BuildOptions options;
+			options.lookupIndex = true;
+			BuiltArchive indexed{"index-only", dir, hash, comp, options};
+			options.nameTable = true;
+			BuiltArchive named{"index-names", dir, hash, comp, options};
+			auto& archive = named.archive;
+			auto& plain		= indexed.archive;
+			THEN("The names are sorted and refer to their entries") {
+				auto [data, len] = archive.Section(SectionId::Names);
+				NameTable names{data, len};
+				REQUIRE(names.Size() == expected.size());
+				for (lam_size_t i = 0; i < names.Size(); ++i) {
+					REQUIRE(names.Name(i) == expected[i]);
+					REQUIRE(names.Equals(i, expected[i]));
+					REQUIRE_FALSE(names.Equals(i, expected[i] + "x"));
+					REQUIRE(names.Find(expected[i]) == i);
+					REQUIRE(names.Entry(i) == archive.OffsetOf(archive[expected[i]]));
+				}
+				REQUIRE_FALSE(names.Find("textures/missing.png"));
+			}
+			AND_THEN("The index is smaller and lookups still work") {
+				auto indexSize = archive.Section(SectionId::LookupIndex).second;
+				auto namesSize = archive.Section(SectionId::Names).second;
+				REQUIRE(indexSize + namesSize <
+								plain.Section(SectionId::LookupIndex).second);
+				for (auto& name : expected) {
+					auto entry = archive[name];
+					REQUIRE(entry);
+					REQUIRE(entry.Name() == name);
+				}
+				REQUIRE_FALSE(archive["textures/missing.png"]);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Entries can be listed by prefix or pattern") {
+	GIVEN("Nested directories of assets") {
+		for (auto sub : {"textures/ui", "textures/ui/icons", "textures/world"}) {
+			fs::create_directories(dir / sub);
+			for (auto file : {"a.png", "b.png", "b.txt", "bc.png"})
+				std::ofstream{dir / sub / file} << sub << file;
+		}
+		std::ofstream{dir / "textures.txt"} << "not a directory";
+		CityHash hash{8.f};
+		ZSTD comp{ZSTD::both};
+		WHEN("We build it with and without a name table") {
+			BuildOptions options;
+			BuiltArchive unnamed{"list-plain", dir, hash, comp, options};
+			options.nameTable = true;
+			BuiltArchive named{"list-names", dir, hash, comp, options};
+			auto& archive = named.archive;
+			auto& plain		= unnamed.archive;
+			auto names = [](auto&& list) {
+				std::vector<std::string> ret;
+				for (auto& [name, id] : list)
+					ret.push_back(name);
+				return ret;
+			};
+			THEN("A prefix lists everything below it in order") {
+				std::vector<std::string> expected{"textures/ui/a.png",
+																					"textures/ui/b.png",
+																					"textures/ui/b.txt",
+																					"textures/ui/bc.png",
+																					"textures/ui/icons/a.png",
+																					"textures/ui/icons/b.png",
+																					"textures/ui/icons/b.txt",
+																					"textures/ui/icons/bc.png"};
+				auto list = archive.List("textures/ui/");
+				REQUIRE(names(list) == expected);
+				REQUIRE(names(plain.List("textures/ui/")) == expected);
+				for (auto& [name, id] : list)
+					REQUIRE(archive[id].Name() == name);
+				REQUIRE(archive.List("").size() == 13);
+				REQUIRE(archive.List("textures/").size() == 12);
+				REQUIRE(archive.List("sounds/").empty());
+			}
+			AND_THEN("A pattern only matches within directories unless it uses **") {
+				std::vector<std::string> expected{"textures/ui/b.png",
+																					"textures/ui/bc.png",
+																					"textures/world/b.png",
+																					"textures/world/bc.png"};
+				REQUIRE(names(archive.Glob("textures/*/b*.png")) == expected);
+				REQUIRE(names(plain.Glob("textures/*/b*.png")) == expected);
+				std::vector<std::string> single{"textures/ui/b.png",
+																				"textures/ui/icons/b.png",
+																				"textures/world/b.png"};
+				REQUIRE(names(archive.Glob("**/b.png")) == single);
+				REQUIRE(names(archive.Glob("textures/ui/?.txt")) ==
+								std::vector<std::string>{"textures/ui/b.txt"});
+				REQUIRE(names(archive.Glob("*.txt")) ==
+								std::vector<std::string>{"textures.txt"});
+				REQUIRE(archive.Glob("textures/ui/b.png").size() == 1);
+				REQUIRE(archive.Glob("textures/ui/?").empty());
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Entries can be retrieved from many threads at once") {
+	GIVEN("An archive compressed with a dictionary") {
+		constexpr auto fileCount = 64;
+		for (auto i = 0; i < fileCount; ++i) {
+			std::ofstream f{dir / ("file"s + std::to_string(i) + ".txt")};
+			for (auto j = 0; j < 2000; ++j)
+				f << "shared text " << j * i << '\n';
+		}
+		CityHash hash;
+		auto dictPath = fs::current_path() / "testme.dict";
+		{
+			ZSTD comp{ZSTD::compress};
+			REQUIRE(comp.CreateDictionary(fs::directory_entry{dir}));
+			auto [dict, dictLen] = comp.Dictionary();
+			std::ofstream{dictPath, std::ios::binary}.write(
+					reinterpret_cast<const char*>(dict), dictLen);
+			StreamWriter out{arc};
+			MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp);
+		}
+		WHEN("A decompressor is moved from one that read its dictionary") {
+			ZSTD comp{ZSTD::decompress};
+			{
+				ZSTD loaded{ZSTD::decompress};
+				loaded.UseDictionary(fs::directory_entry{dictPath});
+				comp = std::move(loaded);
+			}
+			ZSTD other{ZSTD::decompress};
+			MemMapper in{fs::directory_entry{arc}};
+			MemMappedArchive archive{in, other, hash};
+			THEN("It still owns the dictionary") {
+				auto [src, srcLen] = archive["file1.txt"].Compressed();
+				std::vector<uint8_t> buf(comp.CalcDecompressSize(src, srcLen));
+				REQUIRE(comp.Decompress(src, srcLen, buf.data(), buf.size()) ==
+								buf.size());
+				MemMapper onDisk{fs::directory_entry{dir / "file1.txt"}};
+				REQUIRE(ToSV(buf.data(), buf.size()) ==
+								ToSV(onDisk.Get(), onDisk.Size()));
+			}
+		}
+		fs::remove(dictPath);
+		WHEN("Several threads share one archive and decompressor") {
+			ZSTD comp{ZSTD::decompress};
+			MemMapper in{fs::directory_entry{arc}};
+			MemMappedArchive archive{in, comp, hash};
+			std::atomic<int> mismatches{0};
+			std::vector<std::thread> threads;
+			for (auto t = 0; t < 8; ++t)
+				threads.emplace_back([&, t] {
+					for (auto round = 0; round < 20; ++round)
+						for (auto i = 0; i < fileCount; ++i) {
+							auto file =
+									"file"s + std::to_string((i + t) % fileCount) + ".txt";
+							auto [ptr, len] = archive[file].Retrieve();
+							MemMapper onDisk{fs::directory_entry{dir / file}};
+							if (ToSV(ptr.get(), len) != ToSV(onDisk.Get(), onDisk.Size()))
+								++mismatches;
+						}
+				});
+			for (auto& thread : threads)
+				thread.join();
+			THEN("Every retrieval should match the original file") {
+				REQUIRE(mismatches == 0);
+			}
+		}
+		WHEN("A corrupt dictionary is loaded into its decompressor") {
+			ZSTD comp{ZSTD::decompress};
+			MemMapper in{fs::directory_entry{arc}};
+			MemMappedArchive archive{in, comp, hash};
+			// The dictionary magic number followed by garbage entropy tables.
+			std::vector<uint8_t> corrupt(256, 0xFF);
+			corrupt[0] = 0x37;
+			corrupt[1] = 0xA4;
+			corrupt[2] = 0x30;
+			corrupt[3] = 0xEC;
+			THEN("Loading it throws and the archive's dictionary is kept") {
+				REQUIRE_THROWS_AS(comp.UseDictionary(corrupt.data(), corrupt.size()),
+													std::runtime_error);
+				auto [ptr, len] = archive["file1.txt"].Retrieve();
+				MemMapper onDisk{fs::directory_entry{dir / "file1.txt"}};
+				REQUIRE(ToSV(ptr.get(), len) == ToSV(onDisk.Get(), onDisk.Size()));
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Many entries can be retrieved in one batch") {
+	GIVEN("An archive of files of varying sizes") {
+		std::vector<std::string> names;
+		for (auto i = 0; i < 50; ++i) {
+			auto name = "file"s + std::to_string(i) + ".txt";
+			std::ofstream f{dir / name};
+			for (auto j = 0; j <= i * 100; ++j)
+				f << j << ' ';
+			names.push_back(name);
+		}
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		{
+			StreamWriter out{arc};
+			MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp);
+		}
+		MemMapper in{fs::directory_entry{arc}};
+		MemMappedArchive archive{in, comp, hash};
+		ThreadPool pool{4};
+		WHEN("We retrieve them by name along with a missing one") {
+			std::vector<std::string_view> request{names.rbegin(), names.rend()};
+			request.insert(request.begin() + 10, "missing.txt");
+			auto results = archive.RetrieveBatch(request, pool);
+			THEN("Every result matches its request's file") {
+				REQUIRE(results.size() == request.size());
+				for (size_t i = 0; i < request.size(); ++i) {
+					if (i == 10) {
+						REQUIRE(results[i].error);
+						REQUIRE_FALSE(results[i].data);
+						continue;
+					}
+					REQUIRE_FALSE(results[i].error);
+					MemMapper onDisk{fs::directory_entry{dir / request[i]}};
+					REQUIRE(ToSV(results[i].data.get(), results[i].size) ==
+									ToSV(onDisk.Get(), onDisk.Size()));
+				}
+			}
+		}
+		AND_WHEN("We retrieve them into our own buffers") {
+			std::vector<std::vector<uint8_t>> buffers;
+			std::vector<BatchRequest> requests;
+			for (auto& name : names) {
+				auto entry = archive[name];
+				auto& buf	 = buffers.emplace_back(entry.DecompressedSize());
+				requests.push_back({*archive.Resolve(name), buf.data(), buf.size()});
+			}
+			requests.back().capacity /= 2;
+			auto results = archive.RetrieveBatch(requests, pool);
+			THEN("The buffers hold the files and undersized ones are reported") {
+				for (size_t i = 0; i < names.size(); ++i) {
+					REQUIRE_FALSE(results[i].data);
+					if (i + 1 == names.size()) {
+						REQUIRE(results[i].error);
+						continue;
+					}
+					REQUIRE_FALSE(results[i].error);
+					MemMapper onDisk{fs::directory_entry{dir / names[i]}};
+					REQUIRE(ToSV(buffers[i].data(), results[i].size) ==
+									ToSV(onDisk.Get(), onDisk.Size()));
+				}
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Entries can be loaded asynchronously by priority") {
+	GIVEN("An archive and a loader with a single worker") {
+		for (auto i = 0; i < 6; ++i)
+			std::ofstream{dir / ("file"s + std::to_string(i) + ".txt")} << i;
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		{
+			StreamWriter out{arc};
+			MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp);
+		}
+		MemMapper in{fs::directory_entry{arc}};
+		MemMappedArchive archive{in, comp, hash};
+		auto id = [&](int i) {
+			return *archive.Resolve("file"s + std::to_string(i) + ".txt");
+		};
+		std::mutex mtx;
+		std::vector<std::string> completed;
+		auto record = [&](BatchResult result) {
+			std::lock_guard lock{mtx};
+			completed.push_back(result.error ? "error"s
+																			 : std::string{ToSV(result.data.get(),
+																													result.size)});
+		};
+		AsyncLoader loader{archive, 1};
+		WHEN("Requests are queued whilst the worker is busy") {
+			std::promise<void> release;
+			auto busy = release.get_future().share();
+			loader.Load({id(0)}, 0, [&, busy](BatchResult result) {
+				busy.wait();
+				record(std::move(result));
+			});
+			while (loader.Pending() != 0)
+				std::this_thread::yield();
+			loader.Load({id(1)}, -1, record);
+			auto stale = loader.Load({id(2)}, 5, record);
+			loader.Load({id(3)}, 0, record);
+			auto [ticket, future] = loader.Load({id(4)}, 10);
+			loader.Load({id(5)}, 5, record);
+			REQUIRE(loader.Pending() == 5);
+			REQUIRE(loader.Cancel(stale));
+			REQUIRE_FALSE(loader.Cancel(stale));
+			release.set_value();
+			auto result = future.get();
+			for (;; std::this_thread::yield()) {
+				std::lock_guard lock{mtx};
+				if (completed.size() == 5)
+					break;
+			}
+			THEN("They complete by priority and cancelled ones never start") {
+				REQUIRE_FALSE(result.error);
+				REQUIRE(ToSV(result.data.get(), result.size) == "4");
+				std::lock_guard lock{mtx};
+				REQUIRE(completed ==
+								std::vector<std::string>{"error", "0", "5", "3", "1"});
+				REQUIRE_FALSE(loader.Cancel(ticket));
+			}
+		}
+		AND_WHEN("Callbacks are empty or throw") {
+			REQUIRE_THROWS_AS(loader.Load({id(0)}, 0, {}), std::invalid_argument);
+			std::promise<void> thrown;
+			loader.Load({id(0)}, 0, [&thrown](BatchResult) {
+				thrown.set_value();
+				throw std::runtime_error{"Callback failed"};
+			});
+			thrown.get_future().wait();
+			THEN("The loader carries on") {
+				auto [ticket, future] = loader.Load({id(1)});
+				auto result						= future.get();
+				REQUIRE(ToSV(result.data.get(), result.size) == "1");
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Decompressed entries can be cached") {
+	GIVEN("An archive with duplicate files") {
+		for (auto i = 0; i < 4; ++i) {
+			std::ofstream f{dir / ("file"s + std::to_string(i) + ".txt")};
+			for (auto j = 0; j < 1000; ++j)
+				f << i << ' ' << j << '\n';
+		}
+		fs::copy_file(dir / "file0.txt", dir / "copy.txt");
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		{
+			BuildOptions options;
+			options.deduplicate = true;
+			StreamWriter out{arc};
+			MemMappedArchive::Build(
+					fs::directory_entry{dir}, hash, out, comp, options);
+		}
+		MemMapper in{fs::directory_entry{arc}};
+		MemMappedArchive archive{in, comp, hash};
+		auto fileSize = fs::file_size(dir / "file0.txt");
+		WHEN("A single-shard cache can only hold two files") {
+			AssetCache cache{archive, fileSize * 2 + fileSize / 2, 1};
+			auto first = cache.Retrieve("file0.txt");
+			auto again = cache.Retrieve("file0.txt");
+			auto alias = cache.Retrieve("copy.txt");
+			THEN("Repeated retrievals and aliases share one buffer") {
+				MemMapper onDisk{fs::directory_entry{dir / "file0.txt"}};
+				REQUIRE(ToSV(first.first.get(), first.second) ==
+								ToSV(onDisk.Get(), onDisk.Size()));
+				REQUIRE(again.first == first.first);
+				REQUIRE(alias.first == first.first);
+				auto stats = cache.Statistics();
+				REQUIRE(stats.hits == 2);
+				REQUIRE(stats.misses == 1);
+				REQUIRE(stats.entries == 1);
+				REQUIRE(stats.bytes == fileSize);
+			}
+			AND_THEN("The least recently used entry is evicted first") {
+				(void)cache.Retrieve("file1.txt");
+				(void)cache.Retrieve("file0.txt");
+				(void)cache.Retrieve("file2.txt");
+				REQUIRE(cache.Statistics().evictions == 1);
+				(void)cache.Retrieve("file0.txt");
+				REQUIRE(cache.Statistics().misses == 3);
+				(void)cache.Retrieve("file1.txt");
+				auto stats = cache.Statistics();
+				REQUIRE(stats.misses == 4);
+				REQUIRE(stats.evictions == 2);
+				REQUIRE(stats.entries == 2);
+				MemMapper onDisk{fs::directory_entry{dir / "file0.txt"}};
+				REQUIRE(ToSV(first.first.get(), first.second) ==
+								ToSV(onDisk.Get(), onDisk.Size()));
+			}
+			AND_THEN("Missing entries are not cached") {
+				REQUIRE_FALSE(cache.Retrieve("missing.txt").first);
+				cache.Clear();
+				REQUIRE(cache.Statistics().entries == 0);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Entries can be retrieved into a memory resource") {
+	GIVEN("An archive with compressed and stored files") {
+		{
+			std::ofstream f{dir / "text.txt"};
+			for (auto i = 0; i < 1000; ++i)
+				f << "line " << i << '\n';
+		}
+		{
+			std::minstd_rand rng{42};
+			std::ofstream f{dir / "noise.bin", std::ios::binary};
+			for (auto i = 0; i < 4096; ++i)
+				f.put(static_cast<char>(rng()));
+		}
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		{
+			BuildOptions options;
+			options.store = true;
+			StreamWriter out{arc};
+			MemMappedArchive::Build(
+					fs::directory_entry{dir}, hash, out, comp, options);
+		}
+		MemMapper in{fs::directory_entry{arc}};
+		MemMappedArchive archive{in, comp, hash};
+		WHEN("We retrieve them from an arena") {
+			std::pmr::monotonic_buffer_resource arena;
+			auto text	 = archive["text.txt"].Retrieve(arena);
+			auto noise = archive["noise.bin"].Retrieve(arena);
+			THEN("Both are read in full into the arena") {
+				REQUIRE(archive["noise.bin"].Stored().first != nullptr);
+				for (auto [name, result] :
+						 {std::pair{"text.txt", text}, std::pair{"noise.bin", noise}}) {
+					MemMapper onDisk{fs::directory_entry{dir / name}};
+					REQUIRE(ToSV(result.first, result.second) ==
+									ToSV(onDisk.Get(), onDisk.Size()));
+				}
+			}
+		}
+		AND_WHEN("We retrieve them through an allocation callback") {
+			std::vector<size_t> requested;
+			std::vector<uint8_t> storage;
+			auto [buf, len] = archive["text.txt"].Retrieve([&](size_t size) {
+				requested.push_back(size);
+				storage.resize(size);
+				return storage.data();
+			});
+			THEN("The callback is asked once for exactly the right size") {
+				REQUIRE(requested == std::vector<size_t>{len});
+				REQUIRE(len == fs::file_size(dir / "text.txt"));
+				REQUIRE(buf == storage.data());
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "Parts of large files can be read from chunks") {
+	GIVEN("A large file, a small file and a duplicate of the large file") {
+		std::string contents;
+		for (auto i = 0; contents.size() < 100000; ++i)
+			contents += "record " + std::to_string(i) + '\n';
+		std::ofstream{dir / "large.txt"} << contents;
+		std::ofstream{dir / "copy.txt"} << contents;
+		std::ofstream{dir / "small.txt"} << "small";
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		BuildOptions options;
+		options.chunkSize		= 4096;
+		options.deduplicate = true;
+		{
+			StreamWriter out{arc};
+			MemMappedArchive::Build(
+					fs::directory_entry{dir}, hash, out, comp, options);
+		}
+		MemMapper in{fs::directory_entry{arc}};
+		MemMappedArchive archive{in, comp, hash};
+		WHEN("We read the files") {
+			auto large = archive["large.txt"];
+			auto copy	 = archive["copy.txt"];
+			auto small = archive["small.txt"];
+			THEN("Only the large file and its alias are chunked") {
+				REQUIRE(archive.Features() & featureChunks);
+				REQUIRE(large.Chunked());
+				REQUIRE(copy.Chunked());
+				REQUIRE_FALSE(small.Chunked());
+				REQUIRE(large.DecompressedSize() == contents.size());
+				auto [ptr, len] = copy.Retrieve();
+				REQUIRE(ToSV(ptr.get(), len) == contents);
+				auto [smallPtr, smallLen] = small.Retrieve();
+				REQUIRE(ToSV(smallPtr.get(), smallLen) == "small");
+			}
+			AND_THEN("Any range can be read, including across chunks") {
+				std::vector<uint8_t> buf(10000);
+				for (size_t offset : {0, 1, 4095, 4096, 5000, 90000, 99990}) {
+					for (size_t len : {1, 100, 4096, 10000}) {
+						auto expected = std::string_view{contents}.substr(offset, len);
+						REQUIRE(large.Retrieve(offset, buf.data(), len) ==
+										expected.size());
+						REQUIRE(ToSV(buf.data(), expected.size()) == expected);
+						REQUIRE(small.Retrieve(offset % 5, buf.data(), len) ==
+										std::min<size_t>(len, 5 - offset % 5));
+					}
+				}
+				REQUIRE(large.Retrieve(contents.size(), buf.data(), 1) == 0);
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup,
+								"Incremental rebuilds chunk files as the new settings require") {
+	GIVEN("An archive built with a manifest and without chunks") {
+		std::string contents;
+		for (auto i = 0; contents.size() < 100000; ++i)
+			contents += "record " + std::to_string(i) + '\n';
+		std::ofstream{dir / "large.txt"} << contents;
+		std::ofstream{dir / "small.txt"} << "small";
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		BuildOptions options;
+		options.manifest = true;
+		{
+			StreamWriter out{arc};
+			MemMappedArchive::Build(
+					fs::directory_entry{dir}, hash, out, comp, options);
+		}
+		auto rebuild =
+				[&](const fs::path& from, const fs::path& to, lam_size_t chunkSize) {
+					MemMapper in{fs::directory_entry{from}};
+					MemMappedArchive previous{in, comp, hash};
+					BuildOptions incremental;
+					incremental.previous	= &previous;
+					incremental.chunkSize = chunkSize;
+					StreamWriter out{to};
+					MemMappedArchive::Build(
+							fs::directory_entry{dir}, hash, out, comp, incremental);
+				};
+		auto chunked	 = fs::current_path() / "testme-reuse-chunked.lam";
+		auto rechunked = fs::current_path() / "testme-reuse-rechunked.lam";
+		auto unchunked = fs::current_path() / "testme-reuse-unchunked.lam";
+		for (auto& path : {chunked, rechunked, unchunked})
+			fs::remove(path);
+		WHEN("We rebuild it with chunks, other chunks and no chunks") {
+			rebuild(arc, chunked, 4096);
+			rebuild(chunked, rechunked, 8192);
+			rebuild(rechunked, unchunked, 0);
+			THEN("Every file is laid out as a fresh build would") {
+				auto check = [&](const fs::path& path, lam_size_t chunkSize) {
+					MemMapper in{fs::directory_entry{path}};
+					MemMappedArchive archive{in, comp, hash};
+					auto large = archive["large.txt"];
+					REQUIRE(large.Chunked() == (chunkSize != 0));
+					if (chunkSize != 0)
+						REQUIRE(GetLamSizeT(large.Compressed().first) == chunkSize);
+					REQUIRE_FALSE(archive["small.txt"].Chunked());
+					auto [ptr, len] = large.Retrieve();
+					REQUIRE(ToSV(ptr.get(), len) == contents);
+				};
+				check(chunked, 4096);
+				check(rechunked, 8192);
+				check(unchunked, 0);
+			}
+		}
+		for (auto& path : {chunked, rechunked, unchunked})
+			fs::remove(path);
+	}
+}
+
+//! Forwards to ZSTD, leaving DecompressStream() to IDecompress's default.
+class WholeDecompress : public IDecompress {
+	ZSTD& zstd;
+
+public:
+	explicit WholeDecompress(ZSTD& zstd) : zstd{zstd} {}
+
+	size_t Decompress(const uint8_t* src,
+										size_t srcLen,
+										uint8_t* dst,
+										size_t dstLen) override {
+		return zstd.Decompress(src, srcLen, dst, dstLen);
+	}
+
+	[[nodiscard]] size_t
+			CalcDecompressSize(const uint8_t* src, size_t len) const noexcept override {
+		return zstd.CalcDecompressSize(src, len);
+	}
+
+	[[nodiscard]] std::pair<const uint8_t*, size_t>
+			Dictionary() const noexcept override {
+		return zstd.Dictionary();
+	}
+
+	void UseDictionary(const uint8_t* dict, size_t len) override {
+		zstd.UseDictionary(dict, len);
+	}
+};
+
+SCENARIO_METHOD(FSCleanup, "Entries can be streamed a block at a time") {
+	GIVEN("Large compressed, chunked and stored files") {
+		std::string contents;
+		for (auto i = 0; contents.size() < 1000000; ++i)
+			contents += "row " + std::to_string(i * 7919 % 100003) + '\n';
+		std::string noise(300000, '\0');
+		std::minstd_rand rng{7};
+		for (auto& c : noise)
+			c = static_cast<char>(rng());
+		fs::create_directory(dir / "sub");
+		std::ofstream{dir / "whole.txt"} << contents;
+		std::ofstream{dir / "sub" / "chunked.txt"} << contents;
+		std::ofstream{dir / "noise.bin", std::ios::binary} << noise;
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		BuildOptions options;
+		options.store = true;
+		BuiltArchive whole{"stream-whole", dir, hash, comp, options};
+		options.chunkSize = 65536;
+		BuiltArchive split{"stream-chunked", dir, hash, comp, options};
+		auto& archive = whole.archive;
+		auto& chunked = split.archive;
+		WHEN("We stream every file") {
+			THEN("The blocks add up to the file and are bounded in size") {
+				for (auto [arch, name, expected] :
+						 {std::tuple{&archive, "whole.txt", &contents},
+							std::tuple{&chunked, "sub/chunked.txt", &contents},
+							std::tuple{&archive, "noise.bin", &noise},
+							std::tuple{&chunked, "noise.bin", &noise}}) {
+					std::string streamed;
+					size_t largest = 0;
+					auto total		 = (*arch)[name].Stream([&](auto data, auto len) {
+						streamed.append(reinterpret_cast<const char*>(data), len);
+						largest = std::max(largest, len);
+						return true;
+					});
+					REQUIRE(total == expected->size());
+					REQUIRE(streamed == *expected);
+					REQUIRE(largest <= 128 * 1024);
+				}
+			}
+			AND_THEN("Streaming stops as soon as the sink asks it to") {
+				for (auto* arch : {&archive, &chunked}) {
+					size_t calls = 0;
+					auto total	 = (*arch)["whole.txt"].Stream([&](auto, auto) {
+						return ++calls < 2;
+					});
+					REQUIRE(calls == 2);
+					REQUIRE(total < contents.size());
+				}
+			}
+		}
+		WHEN("The decompressor does not stream by itself") {
+			ZSTD zstd{ZSTD::decompress};
+			WholeDecompress decomp{zstd};
+			MemMappedArchive viaDefault{split.in, decomp, hash};
+			THEN("Each chunk is still passed on, in one block") {
+				std::string streamed;
+				size_t calls = 0;
+				auto sink		 = [&](const uint8_t* data, size_t len) {
+					streamed.append(reinterpret_cast<const char*>(data), len);
+					++calls;
+					return true;
+				};
+				auto total = viaDefault["sub/chunked.txt"].Stream(sink);
+				REQUIRE(total == contents.size());
+				REQUIRE(streamed == contents);
+				REQUIRE(calls == (contents.size() + 65535) / 65536);
+			}
+		}
+	}
+}
+
+//! Forwards to a MemMapper and records the hints it is given.
+class RecordingMapper : public IMemMapper {
+	MemMapper& mapper;
+
+public:
+	std::vector<std::pair<size_t, size_t>> needed;
+
+	explicit RecordingMapper(MemMapper& mapper) : mapper{mapper} {}
+
+	IMemMapper& Resize(size_t size) override {
+		mapper.Resize(size);
+		return *this;
+	}
+
+	[[nodiscard]] size_t Size() const noexcept override {
+		return mapper.Size();
+	}
+
+	[[nodiscard]] const uint8_t* Get() const noexcept override {
+		return std::as_const(mapper).Get();
+	}
+
+	[[nodiscard]] uint8_t* Get() noexcept override {
+		return mapper.Get();
+	}
+
+	void WillNeed(size_t offset, size_t len) noexcept override {
+		needed.emplace_back(offset, len);
+		mapper.WillNeed(offset, len);
+	}
+};
+
+SCENARIO_METHOD(FSCleanup, "The data of entries can be prefetched") {
+	GIVEN("An archive of many files") {
+		std::vector<std::string> names;
+		for (auto i = 0; i < 40; ++i) {
+			names.push_back("file"s + std::to_string(i) + ".bin");
+			std::ofstream f{dir / names.back(), std::ios::binary};
+			std::minstd_rand rng(i);
+			for (auto j = 0; j < 3000; ++j)
+				f.put(static_cast<char>(rng()));
+		}
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		{
+			StreamWriter out{arc};
+			MemMappedArchive::Build(fs::directory_entry{dir}, hash, out, comp);
+		}
+		MemMapper mapper{fs::directory_entry{arc}};
+		mapper.Advise(IMemMapper::Access::Random);
+		RecordingMapper in{mapper};
+		MemMappedArchive archive{in, comp, hash};
+		WHEN("We prefetch a subset of them") {
+			std::vector<AssetId> ids;
+			for (size_t i = 0; i < names.size(); i += 3)
+				ids.push_back(*archive.Resolve(names[i]));
+			archive.Prefetch(ids);
+			THEN("The data of every one is covered by few, disjoint ranges") {
+				REQUIRE_FALSE(in.needed.empty());
+				REQUIRE(in.needed.size() <= ids.size());
+				for (size_t i = 1; i < in.needed.size(); ++i)
+					REQUIRE(in.needed[i - 1].first + in.needed[i - 1].second <
+									in.needed[i].first);
+				for (auto id : ids) {
+					auto [data, len] = archive[id].Compressed();
+					size_t offset		 = data - in.Get();
+					REQUIRE(std::any_of(
+							in.needed.begin(), in.needed.end(), [&](auto& range) {
+								return range.first <= offset &&
+											 offset + len <= range.first + range.second;
+							}));
+				}
+				for (auto& name : names) {
+					auto [ptr, len] = archive[name].Retrieve();
+					REQUIRE(len == 3000);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "An archive can be read in and locked when opened") {
+	GIVEN("An archive with a lookup index") {
+		for (auto i = 0; i < 20; ++i)
+			std::ofstream{dir / ("file"s + std::to_string(i) + ".txt")} << i;
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		{
+			BuildOptions options;
+			options.lookupIndex = true;
+			StreamWriter out{arc};
+			MemMappedArchive::Build(
+					fs::directory_entry{dir}, hash, out, comp, options);
+		}
+		WHEN("We open it with every mapping option") {
+			MapOptions options;
+			options.populate	= true;
+			options.lock			= true;
+			options.hugePages = true;
+			MemMapper in{fs::directory_entry{arc}, options};
+			MemMappedArchive archive{in, comp, hash};
+			THEN("It is populated, reports its statistics and reads normally") {
+				REQUIRE(in.Stats().populated);
+				REQUIRE(in.Stats().openTime.count() > 0);
+				// Locking is subject to limits outside of our control.
+				if (in.Stats().locked)
+					REQUIRE(archive.LockIndex());
+				for (auto i = 0; i < 20; ++i) {
+					auto [ptr, len] =
+							archive["file"s + std::to_string(i) + ".txt"].Retrieve();
+					REQUIRE(ToSV(ptr.get(), len) == std::to_string(i));
+				}
+			}
+		}
+		AND_WHEN("We open it without options") {
+			MemMapper in{fs::directory_entry{arc}};
+			THEN("Nothing is reported") {
+				REQUIRE_FALSE(in.Stats().populated);
+				REQUIRE_FALSE(in.Stats().locked);
+			}
+		}
+		AND_WHEN("We open a missing file with options") {
+			auto missing = fs::current_path() / "testme-missing.lam";
+			fs::remove(missing);
+			THEN("It fails without creating the file") {
+				fs::directory_entry ent{missing};
+				REQUIRE_THROWS_AS(MemMapper(ent, MapOptions{}), std::runtime_error);
+				REQUIRE_FALSE(fs::exists(missing));
+			}
+		}
+	}
+}
+
+SCENARIO_METHOD(FSCleanup, "An archive can be read without mapping it") {
+	GIVEN("Files which are chunked, stored and duplicated") {
+		std::string large;
+		for (auto i = 0; i < 10000; ++i)
+			large += std::to_string(i);
+		std::ofstream{dir / "large.txt"} << large;
+		for (auto i = 0; i < 200; ++i) {
+			std::ofstream out{dir / ("file"s + std::to_string(i) + ".txt")};
+			for (auto j = 0; j <= i * 10; ++j)
+				out << (i % 10 == 0 ? "same" : std::to_string(j));
+		}
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		BuildOptions options;
+		options.deduplicate = true;
+		options.store				= true;
+		options.fingerprint = true;
+		options.chunkSize		= 4096;
+		auto check = [&](const BuiltArchive& mapped) {
+			ReadMapper in{fs::directory_entry{mapped.Path()}, 512};
+			MemMappedArchive archive{in, comp, hash};
+			THEN("Only the index is read when it is opened") {
+				REQUIRE(in.BytesRead() < in.Size() / 4);
+				REQUIRE(archive.Features() == mapped.archive.Features());
+				REQUIRE(archive.Fingerprint() == mapped.archive.Fingerprint());
+			}
+			THEN("A lookup only reads the blocks of the entry") {
+				auto before									 = in.BytesRead();
+				auto [ptr, len]							 = archive["file42.txt"].Retrieve();
+				auto [expected, expectedLen] = mapped.archive["file42.txt"].Retrieve();
+				REQUIRE(ToSV(ptr.get(), len) == ToSV(expected.get(), expectedLen));
+				REQUIRE(in.BytesRead() - before < in.Size() / 4);
+				REQUIRE_FALSE(archive["missing.txt"]);
+			}
+			THEN("A part of a chunked file only reads the chunks covering it") {
+				std::vector<uint8_t> part(100);
+				auto read = archive["large.txt"].Retrieve(20000, part.data(), part.size());
+				REQUIRE(read == part.size());
+				REQUIRE(ToSV(part.data(), part.size()) == large.substr(20000, 100));
+				REQUIRE(in.BytesRead() < in.Size() / 2);
+			}
+			THEN("Every entry reads as it does from a mapping") {
+				for (auto i = 0; i < 200; ++i) {
+					auto name	 = "file"s + std::to_string(i) + ".txt";
+					auto entry = archive[name];
+					REQUIRE(entry);
+					REQUIRE(entry.Stored().second ==
+									mapped.archive[name].Stored().second);
+					auto [ptr, len]							 = entry.Retrieve();
+					auto [expected, expectedLen] = mapped.archive[name].Retrieve();
+					REQUIRE(ToSV(ptr.get(), len) == ToSV(expected.get(), expectedLen));
+				}
+				size_t count = 0;
+				for (auto bucket : archive)
+					for (auto& entry : bucket)
+						count += !entry.Name().empty();
+				REQUIRE(count == 201);
+				REQUIRE(archive.List("file1").size() ==
+								mapped.archive.List("file1").size());
+				REQUIRE(in.BytesRead() == in.Size());
+			}
+		};
+		WHEN("It has bucket tags, a lookup index and a name table") {
+			options.bucketTags	= true;
+			options.lookupIndex = true;
+			options.nameTable		= true;
+			check(BuiltArchive{"mapped", dir, hash, comp, options});
+		}
+		WHEN("It has a perfect hash") {
+			options.perfectHash = true;
+			check(BuiltArchive{"mapped", dir, hash, comp, options});
+		}
+	}
+}
+
+#ifndef _WIN32
+SCENARIO_METHOD(FSCleanup, "Batches can be read without faulting pages in") {
+	GIVEN("An archive with stored, chunked and deduplicated files") {
+		std::string large;
+		for (auto i = 0; i < 10000; ++i)
+			large += std::to_string(i);
+		for (auto i = 0; i < 50; ++i) {
+			std::ofstream out{dir / ("file"s + std::to_string(i) + ".txt")};
+			for (auto j = 0; j <= i * 100; ++j)
+				out << (i % 10 == 0 ? "same" : std::to_string(j));
+		}
+		std::ofstream{dir / "large.txt"} << large;
+		CityHash hash;
+		ZSTD comp{ZSTD::both};
+		{
+			BuildOptions options;
+			options.deduplicate = true;
+			options.store				= true;
+			options.chunkSize		= 4096;
+			StreamWriter out{arc};
+			MemMappedArchive::Build(
+					fs::directory_entry{dir}, hash, out, comp, options);
+		}
+		MemMapper in{fs::directory_entry{arc}};
+		MemMappedArchive archive{in, comp, hash};
+		std::vector<BatchRequest> requests;
+		for (auto i = 0; i < 50; ++i)
+			requests.push_back({*archive.Resolve("file"s + std::to_string(i) + ".txt")});
+		requests.push_back({*archive.Resolve("large.txt")});
+		ThreadPool pool{4};
+		auto expected = archive.RetrieveBatch(requests, pool);
+		auto uring		= GENERATE(true, false);
+		WHEN("We read them with " << (uring ? "io_uring" : "pread()")) {
+			BatchReader reader{archive, fs::directory_entry{arc}, 8, uring};
+			if (!uring)
+				REQUIRE_FALSE(reader.Uring());
+			auto results = reader.Read(requests, pool);
+			THEN("They match reading them through the mapping") {
+				REQUIRE(results.size() == expected.size());
+				for (size_t i = 0; i < results.size(); ++i) {
+					REQUIRE_FALSE(results[i].error);
+					REQUIRE(ToSV(results[i].data.get(), results[i].size) ==
+									ToSV(expected[i].data.get(), expected[i].size));
+				}
+			}
+		}
+	}
+}
+#endif